@@ -0,0 +1,103 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "buffer.h"
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Measures page allocation and deletion as the file grows.  With the used
+ * pages in a linked list, appending walked the whole list and so slowed down
+ * with every page; with free-page bitmaps each batch should take about as long
+ * as the first.  Then compares a loader allocating through BufMgr one page at
+ * a time against one allocating runs of pages.
+ */
+int main() {
+  const std::string filename = "alloc_bench.db";
+  const int batches = 8;
+  const int batchSize = 4000;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    Page page;
+    for (int batch = 0; batch < batches; batch++) {
+      Clock::time_point start = Clock::now();
+      for (int i = 0; i < batchSize; i++)
+        file.allocatePage(page);
+      std::cout << "allocate, file of " << (batch + 1) * batchSize
+                << " pages: " << batchSize / millisSince(start)
+                << " K pages/s\n";
+    }
+
+    // free every other page, then take them all back
+    const PageId numPages = (PageId) batches * batchSize;
+    Clock::time_point start = Clock::now();
+    for (PageId i = 1; i <= numPages; i += 2)
+      file.deletePage(i);
+    std::cout << "delete: " << numPages / 2 / millisSince(start)
+              << " K pages/s\n";
+    start = Clock::now();
+    for (PageId i = 1; i <= numPages; i += 2)
+      file.allocatePage(page);
+    std::cout << "reuse: " << numPages / 2 / millisSince(start)
+              << " K pages/s\n";
+  }
+
+  File::remove(filename);
+
+  const std::uint32_t numFrames = 256;
+  const std::uint32_t runLength = 64;
+  const PageId numPages = (PageId) batches * batchSize;
+  for (int runs = 0; runs < 2; runs++) {
+    {
+      File file = File::create(filename);
+      BufMgr bufMgr(numFrames);
+      Clock::time_point start = Clock::now();
+      for (PageId done = 0; done < numPages; done += runLength) {
+        if (runs) {
+          PageId firstPageNo;
+          std::vector<Page*> pages;
+          bufMgr.allocPages(&file, runLength, firstPageNo, pages);
+          for (std::uint32_t i = 0; i < runLength; i++) {
+            pages[i]->insertRecord("alloc_bench");
+            bufMgr.unPinPage(&file, firstPageNo + i, true);
+          }
+        } else {
+          for (std::uint32_t i = 0; i < runLength; i++) {
+            PageId pageNo;
+            Page* page;
+            bufMgr.allocPage(&file, pageNo, page);
+            page->insertRecord("alloc_bench");
+            bufMgr.unPinPage(&file, pageNo, true);
+          }
+        }
+      }
+      bufMgr.flushFile(&file);
+      std::cout << (runs ? "BufMgr runs of 64" : "BufMgr one by one") << ": "
+                << numPages / millisSince(start) << " K pages/s\n";
+    }
+    File::remove(filename);
+  }
+  return 0;
+}
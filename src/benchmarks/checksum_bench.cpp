@@ -0,0 +1,90 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "checksum.h"
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double microsSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+}
+
+/**
+ * Measures what a page checksum costs: the CRC-32C of one page, with the
+ * crc32 instruction and with the table, against reading a page from a file in
+ * the OS page cache (checksum included) and against writing a page and
+ * syncing it to disk.
+ */
+int main() {
+  const std::string filename = "checksum_bench.db";
+  const int crcRounds = 100000;
+  const PageId numPages = 2048;
+  const int syncedWrites = 200;
+
+  Page page;
+  page.insertRecord("checksum_bench");
+  std::uint32_t crc = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < crcRounds; i++)
+    crc = crc32c(&page, Page::SIZE, crc);
+  const double hardwareUs = microsSince(start) / crcRounds;
+  start = Clock::now();
+  for (int i = 0; i < crcRounds / 10; i++)
+    crc = crc32cPortable(&page, Page::SIZE, crc);
+  const double portableUs = microsSince(start) / (crcRounds / 10);
+  std::cout << "CRC-32C of a page: " << hardwareUs << " us"
+            << (crc32cInHardware() ? " (crc32 instruction), "
+                                   : " (no crc32 instruction), ")
+            << portableUs << " us (table)\n";
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    file.setDurability(FileDurability::NO_SYNC);
+    for (PageId i = 0; i < numPages; i++) {
+      Page newPage = file.allocatePage();
+      newPage.insertRecord("checksum_bench");
+      file.writePage(newPage);
+    }
+    file.sync();
+
+    start = Clock::now();
+    for (PageId i = 1; i <= numPages; i++)
+      file.readPage(i, page);
+    const double readUs = microsSince(start) / numPages;
+    std::cout << "page read from the page cache: " << readUs << " us, "
+              << 100 * hardwareUs / readUs << "% of it checksum\n";
+
+    file.setDurability(FileDurability::DATA_SYNC);
+    start = Clock::now();
+    for (int i = 0; i < syncedWrites; i++) {
+      file.writePage(page);
+      file.sync();
+    }
+    const double writeUs = microsSince(start) / syncedWrites;
+    std::cout << "page write synced to disk: " << writeUs << " us, "
+              << 100 * hardwareUs / writeUs << "% of it checksum\n";
+
+    // keeps the loops from being optimized away
+    std::cout << "(crc " << crc << ")\n";
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * The page I/O File used to do, kept here to compare against: one shared
+ * fstream, a seek before every access, a flush after every write, and a latch
+ * around the lot because the stream has a single position.
+ */
+class StreamPageFile {
+ public:
+  explicit StreamPageFile(const std::string& filename)
+      : stream(filename, std::fstream::in | std::fstream::out |
+                             std::fstream::binary) {}
+
+  void readPage(const PageId pageNo, Page& page) {
+    std::lock_guard<std::mutex> guard(latch);
+    FileHeader header;
+    stream.seekg(0, std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    stream.seekg(position(pageNo), std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&page), Page::SIZE);
+  }
+
+  void writePage(const PageId pageNo, const Page& page) {
+    std::lock_guard<std::mutex> guard(latch);
+    PageHeader header;
+    stream.seekg(position(pageNo), std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+    stream.seekp(position(pageNo), std::ios::beg);
+    stream.write(reinterpret_cast<const char*>(&page), Page::SIZE);
+    stream.flush();
+  }
+
+  void sync() {}
+
+ private:
+  static std::streampos position(const PageId pageNo) {
+    return (std::streamoff) pageNo * Page::SIZE;
+  }
+
+  std::fstream stream;
+  std::mutex latch;
+};
+
+/**
+ * The same operations through File.
+ */
+class FdPageFile {
+ public:
+  explicit FdPageFile(File& file) : file(file) {}
+
+  void readPage(const PageId pageNo, Page& page) {
+    file.readPage(pageNo, page);
+  }
+
+  void writePage(const PageId /* pageNo */, const Page& page) {
+    file.writePage(page);
+  }
+
+  void sync() { file.sync(); }
+
+ private:
+  File& file;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Reads the pages in the given order on each of numThreads threads, then
+ * rewrites them in the same order on one thread and syncs, printing the
+ * throughput of both.
+ */
+template <class PageFile>
+static void run(const char* name, PageFile& pageFile,
+                const std::vector<PageId>& order, const int numThreads) {
+  Clock::time_point start = Clock::now();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < numThreads; t++) {
+    threads.push_back(std::thread([&pageFile, &order, t, numThreads]() {
+      Page page;
+      for (std::size_t i = t; i < order.size(); i += numThreads)
+        pageFile.readPage(order[i], page);
+    }));
+  }
+  for (std::size_t t = 0; t < threads.size(); t++)
+    threads[t].join();
+  const double readMs = millisSince(start);
+
+  Page page;
+  start = Clock::now();
+  for (std::size_t i = 0; i < order.size(); i++) {
+    pageFile.readPage(order[i], page);
+    pageFile.writePage(order[i], page);
+  }
+  pageFile.sync();
+  const double writeMs = millisSince(start);
+
+  std::cout << name << ": "
+            << order.size() / readMs << " K reads/s (" << numThreads
+            << " threads), "
+            << order.size() / writeMs << " K read+writes/s\n";
+}
+
+int main() {
+  const std::string filename = "file_io_bench.db";
+  const PageId numPages = 2048;
+  const int numThreads = 4;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    // the fstream never syncs either
+    file.setDurability(FileDurability::NO_SYNC);
+    for (PageId i = 0; i < numPages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("file_io_bench");
+      file.writePage(page);
+    }
+    // the fstream only sees what is on disk
+    file.sync();
+
+    std::vector<PageId> sequential;
+    for (PageId i = 1; i <= numPages; i++)
+      sequential.push_back(i);
+    std::vector<PageId> random(sequential);
+    std::shuffle(random.begin(), random.end(), std::mt19937(564));
+
+    StreamPageFile streamFile(filename);
+    FdPageFile fdFile(file);
+    std::cout << numPages << " pages, file in the OS page cache\n";
+    run("fstream sequential", streamFile, sequential, numThreads);
+    run("pread   sequential", fdFile, sequential, numThreads);
+    run("fstream random    ", streamFile, random, numThreads);
+    run("pread   random    ", fdFile, random, numThreads);
+
+    // switches every File object open on the file to direct I/O
+    File direct = File::open(filename, FileIoMode::DIRECT);
+    if (direct.isDirect()) {
+      FdPageFile directFile(direct);
+      run("direct  sequential", directFile, sequential, numThreads);
+      run("direct  random    ", directFile, random, numThreads);
+    }
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * The chained hash table BufHashTbl used to be, kept here to compare against.
+ */
+class ChainedHashTbl {
+ public:
+  struct Bucket {
+    const File *file;
+    PageId pageNo;
+    FrameId frameNo;
+    Bucket *next;
+  };
+
+  ChainedHashTbl(int htSize) : HTSIZE(htSize) {
+    ht = new Bucket* [htSize];
+    for (int i = 0; i < HTSIZE; i++)
+      ht[i] = NULL;
+  }
+
+  ~ChainedHashTbl() {
+    for (int i = 0; i < HTSIZE; i++) {
+      while (ht[i]) {
+        Bucket *tmpBuc = ht[i];
+        ht[i] = ht[i]->next;
+        delete tmpBuc;
+      }
+    }
+    delete [] ht;
+  }
+
+  void insert(const File* file, const PageId pageNo, const FrameId frameNo) {
+    int index = hash(file, pageNo);
+    Bucket *tmpBuc = new Bucket;
+    tmpBuc->file = file;
+    tmpBuc->pageNo = pageNo;
+    tmpBuc->frameNo = frameNo;
+    tmpBuc->next = ht[index];
+    ht[index] = tmpBuc;
+  }
+
+  bool lookup(const File* file, const PageId pageNo, FrameId &frameNo) {
+    for (Bucket *tmpBuc = ht[hash(file, pageNo)]; tmpBuc; tmpBuc = tmpBuc->next) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        frameNo = tmpBuc->frameNo;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void remove(const File* file, const PageId pageNo) {
+    int index = hash(file, pageNo);
+    Bucket *prevBuc = NULL;
+    for (Bucket *tmpBuc = ht[index]; tmpBuc; prevBuc = tmpBuc, tmpBuc = tmpBuc->next) {
+      if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
+        if (prevBuc)
+          prevBuc->next = tmpBuc->next;
+        else
+          ht[index] = tmpBuc->next;
+        delete tmpBuc;
+        return;
+      }
+    }
+  }
+
+ private:
+  int hash(const File* file, const PageId pageNo) {
+    int tmp = (long)file;
+    return (tmp + pageNo) % HTSIZE;
+  }
+
+  int HTSIZE;
+  Bucket **ht;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Inserts every key, looks each one up several times in random order and
+ * removes them all, printing the throughput of each phase.
+ */
+template <class Table>
+static void run(const char* name, Table& table,
+                const std::vector<const File*>& files,
+                const std::vector<PageId>& pages,
+                const std::vector<std::size_t>& order, const int lookupRounds) {
+  const std::size_t n = pages.size();
+  FrameId frameNo = 0;
+  std::uint64_t checksum = 0;
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < n; i++)
+    table.insert(files[i], pages[i], (FrameId) i);
+  const double insertMs = millisSince(start);
+
+  start = Clock::now();
+  for (int round = 0; round < lookupRounds; round++) {
+    for (std::size_t j = 0; j < n; j++) {
+      const std::size_t i = order[j];
+      table.lookup(files[i], pages[i], frameNo);
+      checksum += frameNo;
+    }
+  }
+  const double lookupMs = millisSince(start);
+
+  start = Clock::now();
+  for (std::size_t j = 0; j < n; j++)
+    table.remove(files[order[j]], pages[order[j]]);
+  const double removeMs = millisSince(start);
+
+  std::cout << name << ": "
+            << n / insertMs / 1000 << " M inserts/s, "
+            << n * lookupRounds / lookupMs / 1000 << " M lookups/s, "
+            << n / removeMs / 1000 << " M removes/s"
+            << " (checksum " << checksum << ")\n";
+}
+
+int main() {
+  const int numFiles = 4;
+  const int numFrames = 1 << 20;
+  const int lookupRounds = 10;
+
+  std::vector<std::string> names;
+  for (int i = 0; i < numFiles; i++) {
+    names.push_back("hash_bench." + std::to_string(i));
+    try {
+      File::remove(names[i]);
+    } catch (const FileNotFoundException &) {
+    }
+  }
+
+  {
+    std::vector<File> openFiles;
+    for (int i = 0; i < numFiles; i++)
+      openFiles.push_back(File::create(names[i]));
+
+    // a buffer pool's worth of keys: runs of consecutive pages from a few files
+    std::vector<const File*> files;
+    std::vector<PageId> pages;
+    for (int i = 0; i < numFrames; i++) {
+      files.push_back(&openFiles[i % numFiles]);
+      pages.push_back(i / numFiles + 1);
+    }
+    std::vector<std::size_t> order(numFrames);
+    for (int i = 0; i < numFrames; i++)
+      order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(564));
+
+    const int htsize = ((((int) (numFrames * 1.2))*2)/2)+1;
+    {
+      ChainedHashTbl chained(htsize);
+      run("chained", chained, files, pages, order, lookupRounds);
+    }
+    {
+      BufHashTbl open(htsize);
+      run("open addressing", open, files, pages, order, lookupRounds);
+    }
+  }
+
+  for (int i = 0; i < numFiles; i++)
+    File::remove(names[i]);
+  return 0;
+}
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "io_engine.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Reads runs of runLength pages, starting at the given page numbers, batch
+ * pages at a time: one after the other with File::readPages(), or all runs of
+ * a batch in flight together through an IoEngine.  With the file in the OS
+ * page cache there is no device latency to hide, so this shows what the
+ * engines cost per request rather than what they save.
+ */
+static void run(const std::string& name, File& file, IoEngine* engine,
+                const std::vector<PageId>& starts, const PageId runLength,
+                const std::size_t batch) {
+  std::vector<Page> buffers(batch * runLength);
+  std::vector<std::vector<Page*> > runs(batch);
+  for (std::size_t r = 0; r < batch; r++) {
+    for (PageId k = 0; k < runLength; k++) {
+      runs[r].push_back(&buffers[r * runLength + k]);
+    }
+  }
+  std::vector<IoRequest> requests(batch);
+
+  Clock::time_point start = Clock::now();
+  for (std::size_t i = 0; i < starts.size(); i += batch) {
+    const std::size_t count = std::min(batch, starts.size() - i);
+    if (engine == NULL) {
+      for (std::size_t r = 0; r < count; r++) {
+        file.readPages(starts[i + r], runs[r]);
+      }
+      continue;
+    }
+    for (std::size_t r = 0; r < count; r++) {
+      file.startReadPages(*engine, starts[i + r], runs[r], requests[r]);
+    }
+    for (std::size_t r = 0; r < count; r++) {
+      engine->wait(&requests[r]);
+      file.finishReadPages(starts[i + r], runs[r], requests[r]);
+    }
+  }
+  std::cout << name << ": "
+            << starts.size() * runLength / millisSince(start) << " K pages/s\n";
+}
+
+int main() {
+  const std::string filename = "io_engine_bench.db";
+  const PageId numPages = 4096;
+  const PageId runLength = 4;
+  const std::size_t batch = 16;
+  const int rounds = 8;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    for (PageId i = 0; i < numPages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("io_engine_bench");
+      file.writePage(page);
+    }
+
+    std::vector<PageId> starts;
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i + runLength <= numPages + 1; i += runLength) {
+        starts.push_back(i);
+      }
+    }
+    std::shuffle(starts.begin(), starts.end(), std::mt19937(564));
+
+    std::unique_ptr<IoEngine> pool(IoEngine::create(batch, false));
+    std::unique_ptr<IoEngine> best(IoEngine::create(batch));
+    std::cout << numPages << " pages, file in the OS page cache, runs of "
+              << runLength << " pages, " << batch << " runs per batch\n";
+    run("one run at a time", file, NULL, starts, runLength, batch);
+    run(pool->name(), file, pool.get(), starts, runLength, batch);
+    run(best->name(), file, best.get(), starts, runLength, batch);
+  }
+
+  File::remove(filename);
+  return 0;
+}
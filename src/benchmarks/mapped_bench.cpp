@@ -0,0 +1,78 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Scans a file that sits in the OS page cache, reading the first record of
+ * every page: through a BufMgr much smaller than the file, which copies each
+ * page into a frame, and in place through File::openMapped().
+ */
+int main() {
+  const std::string filename = "mapped_bench.db";
+  const PageId numPages = 4096;
+  const std::uint32_t numFrames = 256;
+  const int rounds = 10;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    for (PageId i = 0; i < numPages; i++) {
+      Page page = file.allocatePage();
+      page.insertRecord("mapped_bench");
+      file.writePage(page);
+    }
+
+    const double pages = (double) numPages * rounds;
+    std::size_t checksum = 0;
+
+    BufMgr bufMgr(numFrames);
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i <= numPages; i++) {
+        Page* page;
+        bufMgr.readPage(&file, i, page);
+        checksum += page->getRecord(RecordId{i, 1}).size();
+        bufMgr.unPinPage(&file, i, false);
+      }
+    }
+    std::cout << "BufMgr (" << numFrames << " frames): "
+              << pages / millisSince(start) << " K pages/s\n";
+
+    File mapped = File::openMapped(filename);
+    mapped.adviseMapped(MappedAccess::SEQUENTIAL);
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i <= numPages; i++) {
+        const Page* page = mapped.mappedPage(i);
+        checksum += page->getRecord(RecordId{i, 1}).size();
+      }
+    }
+    std::cout << "mapped: " << pages / millisSince(start) << " K pages/s"
+              << " (checksum " << checksum << ")\n";
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,96 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double millisSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * Measures the cost of buffer pool misses.  The file sits in the OS page cache,
+ * so what is left is the work of getting a page from the file stream into a
+ * frame: first the way the miss path used to do it (a temporary Page returned
+ * by File::readPage() and copied into the frame), then reading in place, then
+ * misses through a BufMgr that is far too small for the file.
+ */
+int main() {
+  const std::string filename = "miss_bench.db";
+  const PageId numPages = 2000;
+  const std::uint32_t numFrames = 64;
+  const int rounds = 20;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    {
+      BufMgr loader(numFrames);
+      for (PageId i = 0; i < numPages; i++) {
+        PageId pageNo;
+        Page* page;
+        loader.allocPage(&file, pageNo, page);
+        page->insertRecord("miss_bench");
+        loader.unPinPage(&file, pageNo, true);
+      }
+    }
+
+    const double reads = (double) numPages * rounds;
+    Page frame;
+    std::uint64_t checksum = 0;
+
+    Clock::time_point start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i <= numPages; i++) {
+        frame = file.readPage(i);
+        checksum += frame.page_number();
+      }
+    }
+    std::cout << "copy from temporary page: "
+              << reads / millisSince(start) << " K pages/s\n";
+
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i <= numPages; i++) {
+        file.readPage(i, frame);
+        checksum += frame.page_number();
+      }
+    }
+    std::cout << "read in place: "
+              << reads / millisSince(start) << " K pages/s\n";
+
+    BufMgr bufMgr(numFrames);
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+      for (PageId i = 1; i <= numPages; i++) {
+        Page* page;
+        bufMgr.readPage(&file, i, page);
+        checksum += page->page_number();
+        bufMgr.unPinPage(&file, i, false);
+      }
+    }
+    const double missMs = millisSince(start);
+    std::cout << "BufMgr misses: "
+              << bufMgr.getBufStats().diskreads / missMs << " K misses/s"
+              << " (checksum " << checksum << ")\n";
+  }
+
+  File::remove(filename);
+  return 0;
+}
@@ -0,0 +1,85 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+
+using namespace badgerdb;
+
+/**
+ * Replays the same access trace against a buffer pool using each replacement
+ * policy and prints the hit ratios.  The trace is an OLTP-like working set
+ * (skewed random reads of a hot region of the file) interrupted by sequential
+ * scans of the rest of the file.
+ */
+int main() {
+  const std::string filename = "replacement_bench.db";
+  const PageId numPages = 1000;
+  const std::uint32_t numFrames = 200;
+  const PageId hotPages = 400;
+  const PageId scanPages = 500;
+  const int numAccesses = 100000;
+  const int scanEvery = 2000;
+
+  try {
+    File::remove(filename);
+  } catch (const FileNotFoundException &) {
+  }
+
+  {
+    File file = File::create(filename);
+    {
+      BufMgr loader(numFrames);
+      for (PageId i = 0; i < numPages; i++) {
+        PageId pageNo;
+        Page* page;
+        loader.allocPage(&file, pageNo, page);
+        loader.unPinPage(&file, pageNo, false);
+      }
+    }
+
+    std::vector<PageId> trace;
+    std::mt19937 rng(564);
+    std::geometric_distribution<PageId> hot(3.0 / hotPages);
+    PageId scanStart = hotPages + 1;
+    for (int i = 0; i < numAccesses; i++) {
+      if (i % scanEvery == scanEvery - 1) {
+        for (PageId n = 0; n < scanPages; n++)
+          trace.push_back(scanStart + n);
+        scanStart = scanStart + scanPages <= numPages - scanPages ?
+            scanStart + scanPages : hotPages + 1;
+      }
+      trace.push_back(hot(rng) % hotPages + 1);
+    }
+
+    const char* names[] = {"CLOCK", "ARC", "2Q", "LRU-2"};
+    const ReplacementPolicy policies[] = {
+        ReplacementPolicy::CLOCK, ReplacementPolicy::ARC,
+        ReplacementPolicy::TWO_Q, ReplacementPolicy::LRU_2};
+    std::cout << trace.size() << " accesses, " << numFrames << " frames, "
+              << numPages << " pages\n";
+    for (int p = 0; p < 4; p++) {
+      BufMgr bufMgr(numFrames, policies[p]);
+      for (std::size_t i = 0; i < trace.size(); i++) {
+        Page* page;
+        bufMgr.readPage(&file, trace[i], page);
+        bufMgr.unPinPage(&file, trace[i], false);
+      }
+      const BufStats& stats = bufMgr.getBufStats();
+      std::cout << names[p] << ": hit ratio "
+                << 1.0 - (double) stats.diskreads / stats.accesses << "\n";
+    }
+  }
+
+  File::remove(filename);
+  return 0;
+}
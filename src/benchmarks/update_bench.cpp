@@ -0,0 +1,67 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "page.h"
+
+using namespace badgerdb;
+
+typedef std::chrono::steady_clock Clock;
+
+static double nanosSince(const Clock::time_point& start) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+/**
+ * Updates and deletes records on pages holding more and more of them: updates
+ * to the same length, updates that alternate between two lengths, and deletes
+ * each followed by an insert.  Compacting the page on every delete made all
+ * three cost a pass over the slots and a move of the records below; now an
+ * update that fits is written in place and holes wait for an insert that
+ * needs their space.
+ */
+int main() {
+  const int counts[] = {50, 200, 500};
+  const int rounds = 200000;
+
+  for (int c = 0; c < 3; c++) {
+    const int count = counts[c];
+    Page page;
+    std::vector<RecordId> rids;
+    for (int i = 0; i < count; i++)
+      rids.push_back(page.insertRecord("record"));
+
+    std::mt19937 random(564);
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < rounds; i++)
+      page.updateRecord(rids[random() % count], "update");
+    const double sameNs = nanosSince(start) / rounds;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++)
+      page.updateRecord(rids[random() % count], i % 2 ? "update" : "upd");
+    const double resizeNs = nanosSince(start) / rounds;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+      RecordId& rid = rids[random() % count];
+      page.deleteRecord(rid);
+      rid = page.insertRecord("record");
+    }
+    const double churnNs = nanosSince(start) / rounds;
+
+    std::cout << count << " records: " << sameNs << " ns per same-length "
+              << "update, " << resizeNs << " ns per resizing update, "
+              << churnNs << " ns per delete+insert\n";
+  }
+  return 0;
+}
@@ -15,100 +15,99 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
-{
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
-}
-
 BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+	: HTSIZE(1), numEntries(0)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  // leave a third of the buckets empty when htSize entries are present
+  while (HTSIZE < (std::uint32_t) htSize + htSize / 2)
+    HTSIZE *= 2;
+  // allocate the array of buckets
+  ht = new hashBucket [HTSIZE];
+  for(std::uint32_t i=0; i < HTSIZE; i++)
+    ht[i].fileId = 0;
 }
 
 BufHashTbl::~BufHashTbl()
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
-    }
-  }
   delete [] ht;
 }
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
+  const std::uint32_t mask = HTSIZE - 1;
+  std::uint32_t index = hash(file->id(), pageNo) & mask;
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  while (ht[index].fileId) {
+    if (ht[index].fileId == file->id() && ht[index].pageNo == pageNo)
+  		throw HashAlreadyPresentException(file->filename(), ht[index].pageNo, ht[index].frameNo);
+    index = (index + 1) & mask;
   }
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
+  // always leave some buckets empty so probes terminate
+  if (numEntries + 1 > HTSIZE - HTSIZE / 8)
   	throw HashTableException();
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  ht[index].fileId = file->id();
+  ht[index].pageNo = pageNo;
+  ht[index].frameNo = frameNo;
+  numEntries++;
 }
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
+  if (!find(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
+
+bool BufHashTbl::find(const File* file, const PageId pageNo, FrameId &frameNo) const
+{
+  const std::uint32_t mask = HTSIZE - 1;
+  std::uint32_t index = hash(file->id(), pageNo) & mask;
+  while (ht[index].fileId) {
+    if (ht[index].fileId == file->id() && ht[index].pageNo == pageNo)
     {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
+      frameNo = ht[index].frameNo; // return frameNo by reference
+      return true;
     }
-    tmpBuc = tmpBuc->next;
+    index = (index + 1) & mask;
   }
-
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
+  if (!erase(file, pageNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
+bool BufHashTbl::erase(const File* file, const PageId pageNo) {
 
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
+  const std::uint32_t mask = HTSIZE - 1;
+  std::uint32_t index = hash(file->id(), pageNo) & mask;
 
-      delete tmpBuc;
-      return;
-    }
-		else
+  while (ht[index].fileId)
+	{
+    if (ht[index].fileId == file->id() && ht[index].pageNo == pageNo)
 		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+      // Backward shift: move later entries of the probe run into the hole when
+      // the hole lies between their home bucket and where they sit now.
+      std::uint32_t hole = index;
+      std::uint32_t next = (hole + 1) & mask;
+      while (ht[next].fileId) {
+        const std::uint32_t home = hash(ht[next].fileId, ht[next].pageNo) & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+          ht[hole] = ht[next];
+          hole = next;
+        }
+        next = (next + 1) & mask;
+      }
+      ht[hole].fileId = 0;
+      numEntries--;
+      return true;
     }
+    index = (index + 1) & mask;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  return false;
 }
 
 }
@@ -16,9 +16,9 @@ namespace badgerdb {
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * id of the file (File::id()); 0 if the bucket is empty
 	 */
-	File *file;
+	FileId fileId;
 
 	/**
 	 * page number within a file
@@ -29,43 +29,63 @@ struct hashBucket {
 	 * frame number of page in the buffer pool
 	 */
 	FrameId frameNo;
-
-	/**
-	 * Next node in the hash table
-	 */
-	hashBucket*   next;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
+* Entries are keyed by file id and page number, so every File object open on a file
+* finds the same entries.  They are stored inline in a single power-of-two sized array and found by
+* linear probing.  Removal shifts later entries of the probe run back instead of
+* leaving tombstones, so the table never degrades and never allocates after it
+* is constructed.
+*
 * @warning This class is not threadsafe.
 */
 class BufHashTbl
 {
  private:
 	/**
-	 *	Size of Hash Table
+	 *	Size of Hash Table (number of buckets, a power of two)
+	 */
+  std::uint32_t HTSIZE;
+
+	/**
+	 *	Number of entries currently in the table
 	 */
-  int HTSIZE;
+  std::uint32_t numEntries;
+
 	/**
 	 * Actual Hash table object
 	 */
-  hashBucket**  ht;
+  hashBucket*  ht;
 
+ public:
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * returns 64 bit hash value computed using file id and pageNo.  The low bits pick the
+	 * bucket; BufMgr uses the high bits to pick a partition.
 	 *
-	 * @param file   	File object
+	 * @param fileId 	Id of the file
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+  static std::uint64_t hash(const FileId fileId, const PageId pageNo)
+	{
+		// murmur3 finalizer over the file id and page number
+		std::uint64_t key = (std::uint64_t) fileId << 32 | pageNo;
+		key ^= key >> 33;
+		key *= 0xff51afd7ed558ccdULL;
+		key ^= key >> 33;
+		key *= 0xc4ceb9fe1a85ec53ULL;
+		key ^= key >> 33;
+		return key;
+	}
 
- public:
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize	Number of entries the table must be able to hold
 	 */
 	BufHashTbl(const int htSize);  // constructor
 
@@ -81,7 +101,7 @@ class BufHashTbl
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if the table is too full to take another entry
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
@@ -96,6 +116,16 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the hash table without throwing when it is not.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only set if the entry is found
+	 * @return  			True if the entry was found
+	 */
+  bool find(const File* file, const PageId pageNo, FrameId &frameNo) const;
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +134,15 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Delete entry (file,pageNo) from hash table if it is present.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			True if an entry was removed
+	 */
+  bool erase(const File* file, const PageId pageNo);
 };
 
 }
@@ -5,23 +5,38 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
 #include <memory>
 #include <iostream>
+#include <mutex>
+#include <new>
+#include <limits.h>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_io_exception.h"
 
 namespace badgerdb { 
 
+const FrameId BufMgr::NO_FRAME;
+
+static_assert(Page::SIZE % BufMgr::POOL_ALIGNMENT == 0,
+              "Frames must stay aligned throughout the buffer pool.");
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-    : numBufs(bufs) {
+BufMgr::BufMgr(std::uint32_t bufs, ReplacementPolicy policy)
+    : numBufs(bufs), writerRunning(false), writerCleanTarget(0),
+      readAheadWindow(0), readAheadRunning(false), readAheadCurrent(0),
+      ioEngine(IoEngine::create(IO_QUEUE_DEPTH)) {
     bufDescTable = new BufDesc[bufs];
 
   for (FrameId i = 0; i < bufs; i++) 
@@ -30,42 +45,167 @@ BufMgr::BufMgr(std::uint32_t bufs)
     bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
+  // one block for the whole pool, aligned so frames can go straight to the kernel
+  void* pool = NULL;
+  if (posix_memalign(&pool, POOL_ALIGNMENT, (std::size_t) bufs * sizeof(Page)) != 0)
+    throw std::bad_alloc();
+  bufPool = static_cast<Page*>(pool);
+  for (FrameId i = 0; i < bufs; i++)
+    new (&bufPool[i]) Page();
+
+  // one partition per 64 frames, up to 64 partitions
+  numPartitions = 1;
+  while (numPartitions < 64 && numPartitions * 2 * 64 <= bufs)
+    numPartitions *= 2;
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  hashTables = new BufHashTbl* [numPartitions];
+  hashLatches = new std::mutex[numPartitions];
+  int htsize = ((((int) ((bufs / numPartitions) * 1.2))*2)/2)+1;
+  for (std::uint32_t i = 0; i < numPartitions; i++)
+    hashTables[i] = new BufHashTbl (htsize);  // allocate the buffer hash tables
 
   clockHand = bufs - 1;
+
+  replacer = Replacer::create(policy, bufs);
 }
 
 
 BufMgr::~BufMgr() {
-    //[Flush dirty pages]
+    stopBackgroundWriter();
+    setReadAhead(0);
+
+    //[Flush dirty pages] in a single pass; nobody else may use the pool any more
+    std::vector<File*> written;
     for (std::uint32_t i = 0; i < numBufs; i++) {
-        if (bufDescTable[i].dirty) {
-            flushFile(bufDescTable[i].file);
+        if (bufDescTable[i].valid && bufDescTable[i].dirty) {
+            File* file = bufDescTable[i].file;
+            writeDirtyPage(file, bufPool[i]);
+            bufDescTable[i].dirty = false;
+            bool seen = false;
+            for (std::size_t f = 0; f < written.size() && !seen; f++)
+                seen = written[f]->id() == file->id();
+            if (!seen && file->isOpen())
+                written.push_back(file);
+        }
+    }
+
+    // like flushFile(), have each file write its batch and sync, so that the pages
+    // are as durable as its mode asks
+    for (std::size_t f = 0; f < written.size(); f++) {
+        // a destructor has nobody to tell about a failed write
+        try {
+            written[f]->sync(*ioEngine);
+        } catch (const FileIOException &e) {
         }
     }
 
     //Deallocate arrays
-    delete[] bufPool;
+    free(bufPool);  // Page has a trivial destructor
     delete[] bufDescTable;
 
-    //Deallocate hash table
-    delete hashTable;
+    //Deallocate hash tables
+    for (std::uint32_t i = 0; i < numPartitions; i++)
+        delete hashTables[i];
+    delete[] hashTables;
+    delete[] hashLatches;
+
+    delete replacer;
+    delete ioEngine;
 }
 
-void BufMgr::advanceClock()
+FrameId BufMgr::advanceClock()
 {
-  if (clockHand != numBufs - 1)
-    clockHand = clockHand + 1;
-  else 
-    clockHand = 0;
+  FrameId hand = clockHand.load();
+  FrameId next;
+  do {
+    if (hand != numBufs - 1)
+      next = hand + 1;
+    else 
+      next = 0;
+  } while (!clockHand.compare_exchange_weak(hand, next));
+  return next;
 }
 
-void BufMgr::allocBuf(FrameId & frame) {
+void BufMgr::linkFrame(const FrameId frameNo)
+{
+  BufDesc *frameDesc = &(bufDescTable[frameNo]);
+  std::lock_guard<std::mutex> guard(fileFramesLatch);
+  std::pair<std::unordered_map<FileId, FrameId>::iterator, bool> head =
+      fileFrames.insert(std::make_pair(frameDesc->file->id(), NO_FRAME));
+  frameDesc->filePrev = NO_FRAME;
+  frameDesc->fileNext = head.first->second;
+  if (frameDesc->fileNext != NO_FRAME)
+    bufDescTable[frameDesc->fileNext].filePrev = frameNo;
+  head.first->second = frameNo;
+}
+
+void BufMgr::unlinkFrame(const FrameId frameNo)
+{
+  BufDesc *frameDesc = &(bufDescTable[frameNo]);
+  std::lock_guard<std::mutex> guard(fileFramesLatch);
+  if (frameDesc->fileNext != NO_FRAME)
+    bufDescTable[frameDesc->fileNext].filePrev = frameDesc->filePrev;
+  if (frameDesc->filePrev != NO_FRAME) {
+    bufDescTable[frameDesc->filePrev].fileNext = frameDesc->fileNext;
+  } else if (frameDesc->fileNext != NO_FRAME) {
+    fileFrames[frameDesc->file->id()] = frameDesc->fileNext;
+  } else {
+    // last frame of the file
+    fileFrames.erase(frameDesc->file->id());
+  }
+  frameDesc->fileNext = frameDesc->filePrev = NO_FRAME;
+}
+
+std::uint32_t BufMgr::partitionOf(const File* file, const PageId pageNo) const
+{
+  return partitionOf(file->id(), pageNo);
+}
+
+std::uint32_t BufMgr::partitionOf(const FileId fileId, const PageId pageNo) const
+{
+  // the hash table buckets come from the low bits, so use the high ones here
+  return (std::uint32_t) (BufHashTbl::hash(fileId, pageNo) >> 58) & (numPartitions - 1);
+}
+
+bool BufMgr::waitForLoad(const FrameId frameNo)
+{
+    BufDesc *bufDesc = &(bufDescTable[frameNo]);
+    if (bufDesc->loading) {
+        // the loading thread holds the frame latch until the read is done
+        std::lock_guard<std::mutex> wait(bufDesc->latch);
+    }
+    if (!bufDesc->valid) {
+        // the read failed and the frame was given up
+        bufDesc->pinCnt--;
+        return false;
+    }
+    return true;
+}
+
+bool BufMgr::cleanFrame(const FrameId frameNo)
+{
+    BufDesc *frameDesc = &(bufDescTable[frameNo]);
+    // aligned like the frame, so a direct I/O file can write the copy as it is
+    alignas(POOL_ALIGNMENT) Page pageCopy;
+    {
+        std::lock_guard<std::mutex> guard(hashLatches[partitionOf(frameDesc->file, frameDesc->pageNo)]);
+        if (frameDesc->pinCnt > 0)
+            return false;
+        pageCopy = bufPool[frameNo];
+        frameDesc->dirty = false;
+    }
+    try {
+        writeDirtyPage(frameDesc->file, pageCopy);
+    } catch (...) {
+        // the changes are still only in the frame; don't let eviction drop them
+        frameDesc->dirty = true;
+        throw;
+    }
+    return true;
+}
+
+void BufMgr::allocBuf(FrameId & frame, const std::vector<FrameId>& claimed) {
     uint32_t pinnedCount = 0;
-    // allocBufRecurse(frame, pinnedCount);
     while(true){
  
         if (pinnedCount >= numBufs) {
@@ -73,19 +213,53 @@ void BufMgr::allocBuf(FrameId & frame) {
             throw BufferExceededException();
         }
         
-        advanceClock();
+        FrameId hand;
+        if (replacer != NULL) {
+            // let the replacement policy nominate the frame
+            if (!replacer->pickVictim(hand, [this](FrameId f) { return bufDescTable[f].pinCnt > 0; }))
+                throw BufferExceededException();
+        } else {
+            hand = advanceClock();
+        }
         
         // get the frame pointed by the clock handle
-        BufDesc *frameDesc = &(bufDescTable[clockHand]);
+        BufDesc *frameDesc = &(bufDescTable[hand]);
+
+        // a frame claimed earlier in the batch is latched by this very thread
+        if (std::find(claimed.begin(), claimed.end(), hand) != claimed.end()) {
+            pinnedCount++;
+            if (replacer != NULL)
+                replacer->recordSkip(hand);
+            continue;
+        }
+
+        // skip frames another thread is loading, writing back or evicting
+        std::unique_lock<std::mutex> frameLatch(frameDesc->latch, std::try_to_lock);
+        if (!frameLatch.owns_lock()) {
+            pinnedCount++;
+            if (replacer != NULL)
+                replacer->recordSkip(hand);
+            continue;
+        }
 
         if (!frameDesc->valid) {
+            if (frameDesc->pinCnt > 0) {
+                // a failed read is still being backed out of
+                pinnedCount++;
+                if (replacer != NULL)
+                    replacer->recordSkip(hand);
+                continue;
+            }
             // if the frame is free - use the frame
             frameDesc->Clear();
-            frame = clockHand; 
+            if (replacer != NULL)
+                replacer->recordEvict(hand);
+            frame = hand; 
+            frameLatch.release();
             return;
         }
 
-        if (frameDesc->refbit) {
+        if (replacer == NULL && frameDesc->refbit) {
             // if the ref bit of the frame is set
             // clear the ref bit and go to the next frame
             frameDesc->refbit = false;
@@ -95,22 +269,22 @@ void BufMgr::allocBuf(FrameId & frame) {
             if (frameDesc->pinCnt > 0){
                 // if the page is pinned
                 pinnedCount++;
+                if (replacer != NULL)
+                    replacer->recordSkip(hand);
                 continue;    
             } else {
-                // use this frame
-                File *oldFile = frameDesc->file;
-                PageId oldPageId = frameDesc->pageNo;
-                
-                // flush the current page in the frame if needed
-                if (frameDesc->dirty){
-                    writeDirtyPage(oldFile, bufPool[clockHand]);
+                if (frameDesc->dirty) {
+                    // the background writer (if any) has fallen behind
+                    writerWakeup.notify_one();
+                }
+                if (!evictFrame(hand)) {
+                    pinnedCount++;
+                    if (replacer != NULL)
+                        replacer->recordSkip(hand);
+                    continue;
                 }
-                
-                // remove entry from hash table
-                hashTable->remove(oldFile, oldPageId);
-                // reset the frame desciption
-                frameDesc->Clear();
-                frame = clockHand; 
+                frame = hand; 
+                frameLatch.release();
                 return; 
             }
 
@@ -119,54 +293,311 @@ void BufMgr::allocBuf(FrameId & frame) {
     }
 }
 
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::allocRingBuf(FrameId & frame, BufferAccessStrategy* strategy) {
+    // keep rings to an eighth of the pool so they cannot crowd it out themselves
+    const std::uint32_t ringSize = std::max<std::uint32_t>(1, std::min(strategy->ringSize, numBufs / 8));
+
+    if (strategy->ring.size() < ringSize) {
+        // still filling the ring
+        allocBuf(frame);
+        strategy->ring.push_back(frame);
+        strategy->current = strategy->ring.size() - 1;
+        return;
+    }
+
+    strategy->current = (strategy->current + 1) % strategy->ring.size();
+    const FrameId hand = strategy->ring[strategy->current];
+    BufDesc *frameDesc = &(bufDescTable[hand]);
+    std::unique_lock<std::mutex> frameLatch(frameDesc->latch, std::try_to_lock);
+    if (frameLatch.owns_lock() && frameDesc->pinCnt == 0) {
+        if (!frameDesc->valid) {
+            // flushed or disposed since we last used it
+            frameDesc->Clear();
+            if (replacer != NULL)
+                replacer->recordEvict(hand);
+            frame = hand;
+            frameLatch.release();
+            return;
+        }
+        if (!frameDesc->refbit && evictFrame(hand)) {
+            frame = hand;
+            frameLatch.release();
+            return;
+        }
+    }
+    if (frameLatch.owns_lock())
+        frameLatch.unlock();
+
+    // the frame is busy or has joined somebody else's working set; leave it to the
+    // pool and take a replacement for the ring from there
+    allocBuf(frame);
+    strategy->ring[strategy->current] = frame;
+}
+
+bool BufMgr::evictFrame(const FrameId frameNo)
+{
+    BufDesc *frameDesc = &(bufDescTable[frameNo]);
+    // flush the current page in the frame if needed
+    if (frameDesc->dirty && !cleanFrame(frameNo))
+        return false;
+
+    {
+        const std::uint32_t partition = partitionOf(frameDesc->file, frameDesc->pageNo);
+        std::lock_guard<std::mutex> guard(hashLatches[partition]);
+        // the page may have been pinned again while it was written out
+        if (frameDesc->pinCnt > 0 || frameDesc->dirty)
+            return false;
+        unlinkFrame(frameNo);
+        // remove entry from hash table
+        hashTables[partition]->erase(frameDesc->file, frameDesc->pageNo);
+        // reset the frame desciption
+        frameDesc->Clear();
+    }
+    if (replacer != NULL)
+        replacer->recordEvict(frameNo);
+    return true;
+}
+
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, BufferAccessStrategy* strategy)
 {
-    bufStats.diskreads++;
     bufStats.accesses++;
-    try {
-        // Check if page is in buffer pool
+    const FrameId frameNo = fetchPage(file, pageNo, false, strategy);
+    // return pointer to frame containing page
+    page = &(bufPool[frameNo]);
+
+    if (strategy == NULL && readAheadWindow > 0)
+        noteAccess(file, pageNo);
+}
+
+PageHandle BufMgr::readPage(File* file, const PageId pageNo, BufferAccessStrategy* strategy)
+{
+    Page* page;
+    readPage(file, pageNo, page, strategy);
+    return PageHandle(this, page - bufPool);
+}
+
+FrameId BufMgr::fetchPage(File* file, const PageId pageNo, const bool onlyIfAbsent, BufferAccessStrategy* strategy)
+{
+    const std::uint32_t partition = partitionOf(file, pageNo);
+    while (true) {
         FrameId frameNo = numBufs;
-        hashTable->lookup(file, pageNo, frameNo);
+        {
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            // Check if page is in buffer pool
+            if (hashTables[partition]->find(file, pageNo, frameNo)) {
+                if (onlyIfAbsent)
+                    return numBufs;
 
-        // Page is in buffer pool (Case 2)
+                // Page is in buffer pool (Case 2)
+
+                // get frame
+                BufDesc *bufDesc = &(bufDescTable[frameNo]);
+                // set refbit
+                bufDesc->refbit = true;
+                // increment pinCnt
+                (bufDesc->pinCnt)++;
+            }
+        }
+        if (frameNo < numBufs) {
+            if (!waitForLoad(frameNo))
+                continue;
+            if (replacer != NULL)
+                replacer->recordAccess(frameNo);
+            return frameNo;
+        }
 
-        // get frame
-        BufDesc *bufDesc = &(bufDescTable[frameNo]);
-        // set refbit
-        bufDesc->refbit = true;
-        // increment pinCnt
-        (bufDesc->pinCnt)++;
-        // return pointer to frame containing page
-        page = &(bufPool[frameNo]);
-        return;
-    } catch (HashNotFoundException& e) {}
         // page is not in the buffer pool
         // allocate buffer frame
-        FrameId frameNo = numBufs;
-        allocBuf(frameNo);
+        if (strategy != NULL)
+            allocRingBuf(frameNo, strategy);
+        else
+            allocBuf(frameNo);
 
         // get frame
         BufDesc *bufDesc = &(bufDescTable[frameNo]);
-        // read page from disk into buffer pool frame
-        Page newPage = file->readPage(pageNo);
-        // insert page into hashtable
-        hashTable->insert(file, newPage.page_number(), frameNo);
-        bufPool[frameNo] = newPage;
-        // Set() frame
-        bufDesc->Set(file, bufPool[frameNo].page_number());
-        // return pointer to frame containing page
-        page = &(bufPool[frameNo]);
-        return;
+        {
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            // another thread may have read the page in the meantime
+            FrameId otherFrameNo;
+            if (hashTables[partition]->find(file, pageNo, otherFrameNo)) {
+                if (replacer != NULL)
+                    replacer->recordFree(frameNo);
+                bufDesc->latch.unlock();
+                if (onlyIfAbsent)
+                    return numBufs;
+                continue;
+            }
+            // insert page into hashtable
+            try {
+                hashTables[partition]->insert(file, pageNo, frameNo);
+            } catch (...) {
+                if (replacer != NULL)
+                    replacer->recordFree(frameNo);
+                bufDesc->latch.unlock();
+                throw;
+            }
+            // Set() frame
+            bufDesc->Set(file, pageNo);
+            linkFrame(frameNo);
+            // ring pages only earn a reference bit when someone else uses them
+            if (strategy != NULL)
+                bufDesc->refbit = false;
+            bufDesc->loading = true;
+        }
+
+        bufStats.diskreads++;
+        try {
+            // read page from disk into buffer pool frame
+            file->readPage(pageNo, bufPool[frameNo]);
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> guard(hashLatches[partition]);
+                unlinkFrame(frameNo);
+                hashTables[partition]->erase(file, pageNo);
+                bufDesc->file = NULL;
+                bufDesc->valid = false;
+            }
+            // threads waiting for the page drop their own pins
+            bufDesc->pinCnt--;
+            if (replacer != NULL)
+                replacer->recordFree(frameNo);
+            bufDesc->loading = false;
+            bufDesc->latch.unlock();
+            throw;
+        }
+        if (replacer != NULL)
+            replacer->recordLoad(frameNo, file, pageNo);
+        bufDesc->loading = false;
+        bufDesc->latch.unlock();
+        return frameNo;
+    }
+}
+
+
+void BufMgr::readPages(File* file, const std::vector<PageId>& pageNos, std::vector<Page*>& pages)
+{
+    bufStats.accesses += pageNos.size();
+    std::vector<FrameId> frames(pageNos.size(), numBufs);
+
+    // drops every pin taken so far when the batch cannot be completed
+    struct PinGuard {
+        BufMgr* bufMgr;
+        std::vector<FrameId>& frames;
+        bool done;
+        ~PinGuard() {
+            for (std::size_t i = 0; !done && i < frames.size(); i++)
+                if (frames[i] < bufMgr->numBufs)
+                    bufMgr->unPinFrame(frames[i], false);
+        }
+    } pinGuard = {this, frames, false};
+
+    // pin the pages that are already resident, collecting the first request of each
+    // missing page
+    std::vector<std::pair<PageId, std::size_t> > misses;
+    for (std::size_t i = 0; i < pageNos.size(); i++) {
+        const std::uint32_t partition = partitionOf(file, pageNos[i]);
+        FrameId frameNo = numBufs;
+        {
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            if (hashTables[partition]->find(file, pageNos[i], frameNo)) {
+                bufDescTable[frameNo].refbit = true;
+                bufDescTable[frameNo].pinCnt++;
+            }
+        }
+        if (frameNo < numBufs && waitForLoad(frameNo)) {
+            if (replacer != NULL)
+                replacer->recordAccess(frameNo);
+            frames[i] = frameNo;
+        } else {
+            misses.push_back(std::make_pair(pageNos[i], i));
+        }
+    }
+    std::sort(misses.begin(), misses.end());
+    misses.erase(std::unique(misses.begin(), misses.end(),
+                             [](const std::pair<PageId, std::size_t>& a,
+                                const std::pair<PageId, std::size_t>& b) { return a.first == b.first; }),
+                 misses.end());
+
+    // claim frames for all misses in one sweep of the clock
+    std::vector<FrameId> claimed;
+    try {
+        for (std::size_t m = 0; m < misses.size(); m++) {
+            FrameId frameNo;
+            allocBuf(frameNo, claimed);
+            claimed.push_back(frameNo);
+        }
+    } catch (...) {
+        for (std::size_t m = 0; m < claimed.size(); m++) {
+            if (replacer != NULL)
+                replacer->recordFree(claimed[m]);
+            bufDescTable[claimed[m]].latch.unlock();
+        }
+        throw;
+    }
+
+    std::vector<PageId> missPageNos;
+    for (std::size_t m = 0; m < misses.size(); m++)
+        missPageNos.push_back(misses[m].first);
+    try {
+        loadPages(file, missPageNos, claimed);
+    } catch (...) {
+        // hand what did load to the pin guard
+        for (std::size_t m = 0; m < misses.size(); m++)
+            frames[misses[m].second] = claimed[m];
+        throw;
+    }
+    for (std::size_t m = 0; m < misses.size(); m++)
+        frames[misses[m].second] = claimed[m];
+
+    // repeated pages and pages read in by another thread
+    for (std::size_t i = 0; i < pageNos.size(); i++) {
+        if (frames[i] == numBufs)
+            frames[i] = fetchPage(file, pageNos[i], false, NULL);
+    }
+
+    pinGuard.done = true;
+    pages.resize(pageNos.size());
+    for (std::size_t i = 0; i < pageNos.size(); i++)
+        pages[i] = &(bufPool[frames[i]]);
 }
 
+void BufMgr::unPinPages(File* file, const std::vector<PageId>& pageNos, const bool dirty)
+{
+    // visit the pages partition by partition, taking each partition latch once
+    std::vector<std::pair<std::uint32_t, PageId> > order;
+    order.reserve(pageNos.size());
+    for (std::size_t i = 0; i < pageNos.size(); i++)
+        order.push_back(std::make_pair(partitionOf(file, pageNos[i]), pageNos[i]));
+    std::sort(order.begin(), order.end());
+
+    std::size_t next = 0;
+    while (next < order.size()) {
+        const std::uint32_t partition = order[next].first;
+        std::lock_guard<std::mutex> guard(hashLatches[partition]);
+        for (; next < order.size() && order[next].first == partition; next++) {
+            const PageId pageNo = order[next].second;
+            FrameId fid = numBufs;
+            if (!hashTables[partition]->find(file, pageNo, fid)) {
+                // page not in buffer pool
+                continue;
+            }
+            if (dirty == true) {
+                bufDescTable[fid].dirty = true;
+            }
+            if (bufDescTable[fid].pinCnt <= 0) {
+                throw PageNotPinnedException(file->filename(), pageNo, fid);
+            }
+            bufDescTable[fid].pinCnt--;
+        }
+    }
+}
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+    const std::uint32_t partition = partitionOf(file, pageNo);
+    std::lock_guard<std::mutex> guard(hashLatches[partition]);
     FrameId fid = numBufs;
-    try 
-    {
-        hashTable->lookup(file, pageNo, fid);
-    } catch (HashNotFoundException &ex) {
+    if (!hashTables[partition]->find(file, pageNo, fid)) {
         // page not in buffer pool
         return;
     }
@@ -180,43 +611,151 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
         throw PageNotPinnedException(file->filename(), pageNo, fid);
     } else {
         // decrement frame pin count
-        bufDescTable[fid].pinCnt = bufDescTable[fid].pinCnt - 1;
+        bufDescTable[fid].pinCnt--;
     }
 
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) {
-    bufStats.diskreads++;
-    // allocate empty page in file
-    Page pageContent = file->allocatePage();
-    pageNo = pageContent.page_number(); 
+PageHandle BufMgr::allocPage(File* file, PageId &pageNo, BufferAccessStrategy* strategy) {
+    Page* page;
+    allocPage(file, pageNo, page, strategy);
+    return PageHandle(this, page - bufPool);
+}
+
+void BufMgr::unPinFrame(const FrameId frameNo, const bool dirty)
+{
+    // the pin keeps the frame mapped, so there is nothing to look up; mark it dirty
+    // before dropping the pin so that whoever sees it unpinned also sees it dirty
+    if (dirty)
+        bufDescTable[frameNo].dirty = true;
+    bufDescTable[frameNo].pinCnt--;
+}
+
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page, BufferAccessStrategy* strategy) {
     // allocate frame in buffer pool for page
     FrameId frameId = numBufs;
-    allocBuf(frameId);
-   
+    if (strategy != NULL)
+        allocRingBuf(frameId, strategy);
+    else
+        allocBuf(frameId);
+
+    bufStats.diskreads++;
+    try {
+        // allocate empty page in file; the frame is still private to this thread, so
+        // build the page in it before publishing it
+        file->allocatePage(bufPool[frameId]);
+    } catch (...) {
+        if (replacer != NULL)
+            replacer->recordFree(frameId);
+        bufDescTable[frameId].latch.unlock();
+        throw;
+    }
+    pageNo = bufPool[frameId].page_number(); 
+
     // add page to buffer pool 
-    hashTable->insert(file, pageNo, frameId);  
-    bufDescTable[frameId].Set(file, pageNo);
-    bufPool[frameId] = pageContent;
+    const std::uint32_t partition = partitionOf(file, pageNo);
+    {
+        std::lock_guard<std::mutex> guard(hashLatches[partition]);
+        try {
+            hashTables[partition]->insert(file, pageNo, frameId);
+        } catch (...) {
+            if (replacer != NULL)
+                replacer->recordFree(frameId);
+            bufDescTable[frameId].latch.unlock();
+            throw;
+        }
+        bufDescTable[frameId].Set(file, pageNo);
+        linkFrame(frameId);
+        if (strategy != NULL)
+            bufDescTable[frameId].refbit = false;
+    }
+    if (replacer != NULL)
+        replacer->recordLoad(frameId, file, pageNo);
+    bufDescTable[frameId].latch.unlock();
     page = &bufPool[frameId];
 }
 
+void BufMgr::allocPages(File* file, const std::uint32_t count, PageId &firstPageNo, std::vector<Page*>& pages, const bool preallocate)
+{
+    // claim the frames first, so that a shortage leaves the file alone; like in
+    // allocPage(), the pages are built in the frames before they are published
+    std::vector<FrameId> claimed;
+    std::vector<Page*> framePages;
+    try {
+        for (std::uint32_t i = 0; i < count; i++) {
+            FrameId frameNo;
+            allocBuf(frameNo, claimed);
+            claimed.push_back(frameNo);
+            framePages.push_back(&bufPool[frameNo]);
+        }
+        firstPageNo = file->allocatePages(framePages, preallocate);
+    } catch (...) {
+        for (std::size_t i = 0; i < claimed.size(); i++) {
+            if (replacer != NULL)
+                replacer->recordFree(claimed[i]);
+            bufDescTable[claimed[i]].latch.unlock();
+        }
+        throw;
+    }
+    bufStats.diskreads += count;
+
+    for (std::uint32_t i = 0; i < count; i++) {
+        const PageId pageNo = firstPageNo + i;
+        const std::uint32_t partition = partitionOf(file, pageNo);
+        {
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            try {
+                hashTables[partition]->insert(file, pageNo, claimed[i]);
+            } catch (...) {
+                // the pages before this one are published already; give up the rest
+                for (std::size_t j = i; j < claimed.size(); j++) {
+                    if (replacer != NULL)
+                        replacer->recordFree(claimed[j]);
+                    bufDescTable[claimed[j]].latch.unlock();
+                }
+                throw;
+            }
+            bufDescTable[claimed[i]].Set(file, pageNo);
+            linkFrame(claimed[i]);
+        }
+        if (replacer != NULL)
+            replacer->recordLoad(claimed[i], file, pageNo);
+        bufDescTable[claimed[i]].latch.unlock();
+    }
+    pages = framePages;
+}
+
 void BufMgr::writeDirtyPage(File* file, const Page& page) {
-    if (file != NULL && file->isOpen(file->filename())) { 
-    	file->writePage(page);
+    if (file != NULL && file->isOpen()) { 
+    	file->writePage(page, *ioEngine);
 	bufStats.diskwrites++;
     } else {
     	// error handling
     }
 }
 
-void BufMgr::flushFile(const File* file) {
+void BufMgr::flushFile(File* file) {
     PageId pid = Page::INVALID_NUMBER;
 
-    // scan buffer pool for pages belong to file
-    for (std::uint32_t i = 0; i < numBufs; i++) {
+    // don't let read-ahead bring pages of the file back in behind us
+    cancelReadAhead(file);
+
+    // visit only the frames holding pages of the file
+    std::vector<FrameId> frames;
+    {
+        std::lock_guard<std::mutex> guard(fileFramesLatch);
+        std::unordered_map<FileId, FrameId>::const_iterator head = fileFrames.find(file->id());
+        if (head != fileFrames.end())
+            for (FrameId i = head->second; i != NO_FRAME; i = bufDescTable[i].fileNext)
+                frames.push_back(i);
+    }
 
-        if (bufDescTable[i].file != NULL && bufDescTable[i].file->filename() == file->filename()) {
+    for (std::size_t f = 0; f < frames.size(); f++) {
+        const FrameId i = frames[f];
+
+        std::lock_guard<std::mutex> frameLatch(bufDescTable[i].latch);
+        // the frame may have been evicted and reused since the list was taken
+        if (bufDescTable[i].file != NULL && bufDescTable[i].file->id() == file->id()) {
             // invalid page
             if (bufDescTable[i].valid == false)
                 throw BadBufferException(i, bufDescTable[i].dirty, false, bufDescTable[i].refbit);
@@ -229,44 +768,476 @@ void BufMgr::flushFile(const File* file) {
                 throw PagePinnedException(file->filename(), pid, i);
 
             // write page if dirty
-            if (bufDescTable[i].dirty == true){
-		            writeDirtyPage(bufDescTable[i].file, bufPool[i]);
-                bufDescTable[i].dirty = false;
-            }
+            if (bufDescTable[i].dirty == true && !cleanFrame(i))
+                throw PagePinnedException(file->filename(), pid, i);
             
-            // remove the page from hashtable
-            hashTable->remove(file, pid);
-
-            // clear buf description for page frame
+            // remove the page from hashtable and clear buf description for page frame
+            const std::uint32_t partition = partitionOf(bufDescTable[i].file, pid);
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            if (bufDescTable[i].pinCnt != 0)
+                throw PagePinnedException(file->filename(), pid, i);
+            unlinkFrame(i);
+            hashTables[partition]->erase(bufDescTable[i].file, pid);
             bufDescTable[i].Clear();
+            if (replacer != NULL)
+                replacer->recordFree(i);
         }
 
     }
 
+    // the barrier: the file writes what it has buffered in one go and syncs
+    file->sync(*ioEngine);
 }
 
 void BufMgr::disposePage(File* file, const PageId PageNo){
     
     //only proceed if valid file is provided
     if (file != NULL) {
+        const std::uint32_t partition = partitionOf(file, PageNo);
         FrameId frameNo = numBufs;
 
-        try {
-            hashTable->lookup(file, PageNo, frameNo);
-        } catch (HashNotFoundException &e){
-            // if the page does not have a frame allocated 
-            frameNo = numBufs;
+        {
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            if (!hashTables[partition]->find(file, PageNo, frameNo)) {
+                // if the page does not have a frame allocated 
+                frameNo = numBufs;
+            }
         }
         
         if (frameNo < numBufs){
-            hashTable->remove(file, PageNo);
-            bufDescTable[frameNo].Clear();
+            // frame latch comes before the partition latch
+            std::lock_guard<std::mutex> frameLatch(bufDescTable[frameNo].latch);
+            std::lock_guard<std::mutex> guard(hashLatches[partition]);
+            // recheck, the frame may have been evicted before we got its latch
+            if (bufDescTable[frameNo].valid && bufDescTable[frameNo].file->id() == file->id() &&
+                bufDescTable[frameNo].pageNo == PageNo) {
+                unlinkFrame(frameNo);
+                hashTables[partition]->erase(file, PageNo);
+                bufDescTable[frameNo].Clear();
+                if (replacer != NULL)
+                    replacer->recordFree(frameNo);
+            }
         }
 
         file->deletePage(PageNo);
     }
 }
 
+void BufMgr::startBackgroundWriter(std::uint32_t cleanTarget)
+{
+    std::lock_guard<std::mutex> guard(writerLatch);
+    writerCleanTarget = cleanTarget;
+    if (!writerRunning) {
+        writerRunning = true;
+        writerThread = std::thread(&BufMgr::backgroundWriter, this);
+    }
+}
+
+void BufMgr::stopBackgroundWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(writerLatch);
+        if (!writerRunning)
+            return;
+        writerRunning = false;
+    }
+    writerWakeup.notify_one();
+    writerThread.join();
+}
+
+void BufMgr::backgroundWriter()
+{
+    std::unique_lock<std::mutex> guard(writerLatch);
+    while (writerRunning) {
+        const std::uint32_t cleanTarget = std::min(writerCleanTarget, numBufs);
+        guard.unlock();
+
+        // walk ahead of the clock hand, counting the frames it could take as they are
+        std::uint32_t clean = 0;
+        FrameId pos = clockHand;
+        for (std::uint32_t scanned = 0; scanned < numBufs && clean < cleanTarget; scanned++) {
+            pos = (pos != numBufs - 1) ? pos + 1 : 0;
+            BufDesc *frameDesc = &(bufDescTable[pos]);
+
+            if (!frameDesc->valid) {
+                if (frameDesc->pinCnt == 0)
+                    clean++;
+                continue;
+            }
+            // the hand will pass over pinned and recently referenced frames this time round
+            if (frameDesc->pinCnt > 0 || (replacer == NULL && frameDesc->refbit))
+                continue;
+            if (!frameDesc->dirty) {
+                clean++;
+                continue;
+            }
+
+            std::unique_lock<std::mutex> frameLatch(frameDesc->latch, std::try_to_lock);
+            try {
+                if (frameLatch.owns_lock() && frameDesc->valid && frameDesc->dirty && cleanFrame(pos))
+                    clean++;
+            } catch (const std::exception &e) {
+                // nobody to throw to here; the page stays dirty for a flush to retry and report
+                bufStats.writerfailures++;
+            }
+        }
+
+        guard.lock();
+        if (writerRunning)
+            writerWakeup.wait_for(guard, std::chrono::milliseconds(10));
+    }
+}
+
+void BufMgr::setReadAhead(std::uint32_t maxWindow)
+{
+    std::unique_lock<std::mutex> guard(readAheadLatch);
+    if (readAheadRunning) {
+        // stop the current reader first, dropping whatever it had queued
+        readAheadRunning = false;
+        readAheadQueue.clear();
+        guard.unlock();
+        readAheadWakeup.notify_all();
+        readAheadThread.join();
+    } else {
+        guard.unlock();
+    }
+
+    // stream latches are taken before readAheadLatch, never after
+    for (std::uint32_t i = 0; i < NUM_READ_AHEAD_STREAMS; i++) {
+        std::lock_guard<std::mutex> streamGuard(readAheadStreams[i].latch);
+        readAheadStreams[i].fileId = 0;
+    }
+
+    guard.lock();
+    readAheadWindow = maxWindow;
+    if (maxWindow > 0) {
+        readAheadRunning = true;
+        readAheadThread = std::thread(&BufMgr::readAheadWorker, this);
+    }
+}
+
+void BufMgr::noteAccess(File* file, const PageId pageNo)
+{
+    ReadAheadStream *stream = &(readAheadStreams[BufHashTbl::hash(file->id(), 0) % NUM_READ_AHEAD_STREAMS]);
+    std::unique_lock<std::mutex> streamGuard(stream->latch, std::try_to_lock);
+    if (!streamGuard.owns_lock())
+        return;
+
+    if (stream->fileId != file->id() || pageNo != stream->lastPage + 1) {
+        if (stream->fileId != file->id() || pageNo != stream->lastPage) {
+            // random access (or a new file): start over
+            stream->fileId = file->id();
+            stream->window = 0;
+            stream->nextPage = pageNo + 1;
+        }
+        stream->lastPage = pageNo;
+        return;
+    }
+    stream->lastPage = pageNo;
+
+    // sequential: once no more than half a window is left in flight, double the
+    // window and queue the pages up to its end
+    if (stream->nextPage <= pageNo)
+        stream->nextPage = pageNo + 1;
+    if (stream->nextPage - pageNo - 1 > stream->window / 2)
+        return;
+    const std::uint32_t maxWindow = readAheadWindow;
+    stream->window = std::min(maxWindow, stream->window == 0 ? 4 : stream->window * 2);
+    const PageId lastToRead = pageNo + stream->window;
+
+    {
+        std::lock_guard<std::mutex> guard(readAheadLatch);
+        if (!readAheadRunning)
+            return;
+        for (PageId next = stream->nextPage; next <= lastToRead; next++) {
+            PageKey key = {file->id(), next};
+            readAheadQueue.push_back(key);
+        }
+    }
+    stream->nextPage = lastToRead + 1;
+    readAheadWakeup.notify_all();
+}
+
+void BufMgr::loadPages(File* file, const std::vector<PageId>& pageNos, std::vector<FrameId>& frames)
+{
+    std::exception_ptr error;
+
+    // map the pages; those another thread has read in since are left to it
+    for (std::size_t m = 0; m < pageNos.size(); m++) {
+        BufDesc *bufDesc = &(bufDescTable[frames[m]]);
+        const std::uint32_t partition = partitionOf(file, pageNos[m]);
+        std::lock_guard<std::mutex> guard(hashLatches[partition]);
+        FrameId otherFrameNo;
+        if (hashTables[partition]->find(file, pageNos[m], otherFrameNo)) {
+            if (replacer != NULL)
+                replacer->recordFree(frames[m]);
+            bufDesc->latch.unlock();
+            frames[m] = numBufs;
+            continue;
+        }
+        try {
+            hashTables[partition]->insert(file, pageNos[m], frames[m]);
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+            if (replacer != NULL)
+                replacer->recordFree(frames[m]);
+            bufDesc->latch.unlock();
+            frames[m] = numBufs;
+            continue;
+        }
+        bufDesc->Set(file, pageNos[m]);
+        linkFrame(frames[m]);
+        bufDesc->loading = true;
+    }
+
+    // one request per run of consecutive page numbers; the requests must not move once
+    // submitted, so all runs are laid out first
+    struct Run {
+        std::size_t begin, end;
+        std::vector<Page*> pages;
+        IoRequest request;
+        bool started;
+    };
+    std::vector<Run> runs;
+    std::size_t next = 0;
+    while (next < pageNos.size()) {
+        if (frames[next] == numBufs) {
+            next++;
+            continue;
+        }
+        Run run;
+        run.begin = next;
+        run.end = next + 1;
+        while (run.end < pageNos.size() && frames[run.end] != numBufs &&
+               pageNos[run.end] == pageNos[run.end - 1] + 1 && run.end - run.begin < IOV_MAX)
+            run.end++;
+        for (std::size_t k = run.begin; k < run.end; k++)
+            run.pages.push_back(&(bufPool[frames[k]]));
+        run.started = false;
+        runs.push_back(run);
+        next = run.end;
+    }
+
+    for (std::size_t r = 0; r < runs.size(); r++) {
+        bufStats.diskreads += runs[r].end - runs[r].begin;
+        try {
+            file->startReadPages(*ioEngine, pageNos[runs[r].begin], runs[r].pages, runs[r].request);
+            runs[r].started = true;
+        } catch (...) {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+
+    for (std::size_t r = 0; r < runs.size(); r++) {
+        bool loaded = false;
+        if (runs[r].started) {
+            ioEngine->wait(&(runs[r].request));
+            try {
+                file->finishReadPages(pageNos[runs[r].begin], runs[r].pages, runs[r].request);
+                loaded = true;
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        for (std::size_t k = runs[r].begin; k < runs[r].end; k++) {
+            BufDesc *bufDesc = &(bufDescTable[frames[k]]);
+            if (loaded) {
+                if (replacer != NULL)
+                    replacer->recordLoad(frames[k], file, pageNos[k]);
+            } else {
+                // give the frame back
+                {
+                    std::lock_guard<std::mutex> guard(hashLatches[partitionOf(file, pageNos[k])]);
+                    unlinkFrame(frames[k]);
+                    hashTables[partitionOf(file, pageNos[k])]->erase(file, pageNos[k]);
+                    bufDesc->file = NULL;
+                    bufDesc->valid = false;
+                }
+                bufDesc->pinCnt--;
+                if (replacer != NULL)
+                    replacer->recordFree(frames[k]);
+            }
+            bufDesc->loading = false;
+            bufDesc->latch.unlock();
+            if (!loaded)
+                frames[k] = numBufs;
+        }
+    }
+
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void BufMgr::prefetchPages(File* file, std::vector<PageId> pageNos)
+{
+    std::sort(pageNos.begin(), pageNos.end());
+    pageNos.erase(std::unique(pageNos.begin(), pageNos.end()), pageNos.end());
+
+    std::vector<PageId> absent;
+    for (std::size_t i = 0; i < pageNos.size(); i++) {
+        const std::uint32_t partition = partitionOf(file, pageNos[i]);
+        std::lock_guard<std::mutex> guard(hashLatches[partition]);
+        FrameId frameNo;
+        if (!hashTables[partition]->find(file, pageNos[i], frameNo))
+            absent.push_back(pageNos[i]);
+    }
+
+    // take whatever frames can be had; the pages beyond them are not read ahead
+    std::vector<FrameId> frames;
+    try {
+        while (frames.size() < absent.size()) {
+            FrameId frameNo;
+            allocBuf(frameNo, frames);
+            frames.push_back(frameNo);
+        }
+    } catch (BufferExceededException &e) {
+        absent.resize(frames.size());
+    }
+
+    try {
+        loadPages(file, absent, frames);
+    } catch (BadgerDbException &e) {
+        // past the end of the file or a free page; the foreground read will find out
+        // for itself
+    }
+    for (std::size_t i = 0; i < frames.size(); i++) {
+        if (frames[i] < numBufs)
+            unPinFrame(frames[i], false);
+    }
+}
+
+void BufMgr::readAheadWorker()
+{
+    std::unique_lock<std::mutex> guard(readAheadLatch);
+    while (true) {
+        while (readAheadRunning && readAheadQueue.empty())
+            readAheadWakeup.wait(guard);
+        if (!readAheadRunning)
+            return;
+
+        // take the pages queued behind it for the same file along, so they are all in
+        // flight together
+        const FileId fileId = readAheadQueue.front().fileId;
+        std::vector<PageId> pageNos;
+        while (!readAheadQueue.empty() && readAheadQueue.front().fileId == fileId &&
+               pageNos.size() < READ_AHEAD_BATCH) {
+            pageNos.push_back(readAheadQueue.front().pageNo);
+            readAheadQueue.pop_front();
+        }
+
+        // the queue holds no File objects, which may be gone by now; read through one
+        // whose pages are still in the pool, or not at all.  flushFile() waits for us
+        // from here on.
+        readAheadCurrent = fileId;
+        guard.unlock();
+
+        FrameId frameNo;
+        File* file = pinResidentFile(fileId, frameNo);
+        if (file != NULL) {
+            if (file->isOpen())
+                prefetchPages(file, pageNos);
+            unPinFrame(frameNo, false);
+        }
+
+        guard.lock();
+        readAheadCurrent = 0;
+        readAheadWakeup.notify_all();
+    }
+}
+
+File* BufMgr::pinResidentFile(const FileId fileId, FrameId& frameNo)
+{
+    PageId pageNo;
+    {
+        std::lock_guard<std::mutex> guard(fileFramesLatch);
+        std::unordered_map<FileId, FrameId>::const_iterator head = fileFrames.find(fileId);
+        if (head == fileFrames.end())
+            return NULL;
+        frameNo = head->second;
+        pageNo = bufDescTable[frameNo].pageNo;
+    }
+
+    // the frame may have been evicted since; with its partition latched it can no
+    // longer be, so if it is still first in the list with the same page, its File
+    // object is still in use and pinning the frame keeps it that way
+    std::lock_guard<std::mutex> guard(hashLatches[partitionOf(fileId, pageNo)]);
+    std::lock_guard<std::mutex> listGuard(fileFramesLatch);
+    std::unordered_map<FileId, FrameId>::const_iterator head = fileFrames.find(fileId);
+    if (head == fileFrames.end() || head->second != frameNo ||
+        bufDescTable[frameNo].pageNo != pageNo)
+        return NULL;
+    bufDescTable[frameNo].pinCnt++;
+    return bufDescTable[frameNo].file;
+}
+
+void BufMgr::cancelReadAhead(const File* file)
+{
+    std::unique_lock<std::mutex> guard(readAheadLatch);
+    std::deque<PageKey>::iterator it = readAheadQueue.begin();
+    while (it != readAheadQueue.end()) {
+        if (it->fileId == file->id())
+            it = readAheadQueue.erase(it);
+        else
+            ++it;
+    }
+    while (readAheadCurrent == file->id())
+        readAheadWakeup.wait(guard);
+}
+
+//----------------------------------------
+// PageHandle
+//----------------------------------------
+
+PageHandle::PageHandle()
+    : bufMgr(NULL), frame(0), dirty(false) {
+}
+
+PageHandle::PageHandle(BufMgr* bufMgr, FrameId frame)
+    : bufMgr(bufMgr), frame(frame), dirty(false) {
+}
+
+PageHandle::PageHandle(PageHandle&& other)
+    : bufMgr(other.bufMgr), frame(other.frame), dirty(other.dirty) {
+    other.bufMgr = NULL;
+}
+
+PageHandle& PageHandle::operator=(PageHandle&& other) {
+    if (this != &other) {
+        release();
+        bufMgr = other.bufMgr;
+        frame = other.frame;
+        dirty = other.dirty;
+        other.bufMgr = NULL;
+    }
+    return *this;
+}
+
+PageHandle::~PageHandle() {
+    release();
+}
+
+Page* PageHandle::get() const {
+    return bufMgr != NULL ? &(bufMgr->bufPool[frame]) : NULL;
+}
+
+PageId PageHandle::pageNo() const {
+    if (bufMgr == NULL)
+        return Page::INVALID_NUMBER;
+    return bufMgr->bufPool[frame].page_number();
+}
+
+void PageHandle::release() {
+    if (bufMgr != NULL) {
+        bufMgr->unPinFrame(frame, dirty);
+        bufMgr = NULL;
+        dirty = false;
+    }
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
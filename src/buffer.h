@@ -7,8 +7,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 #include "file.h"
 #include "bufHashTbl.h"
+#include "io_engine.h"
+#include "replacer.h"
 
 namespace badgerdb {
 
@@ -19,6 +29,11 @@ class BufMgr;
 
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* file, pageNo and valid only change while holding both the frame latch and the
+* latch of the hash table partition the (file, pageNo) key belongs to.  pinCnt is
+* only incremented while holding that partition latch, so a thread holding it can
+* trust a zero pin count until it lets go.
 */
 class BufDesc {
 
@@ -43,22 +58,37 @@ class BufDesc {
 	/**
    * Number of times this page has been pinned
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  std::atomic<bool> dirty;
 
 	/**
    * True if page is valid
 	 */
-  bool valid;
+  std::atomic<bool> valid;
 
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
+
+	/**
+   * True while the page is being read into the frame from disk
+	 */
+  std::atomic<bool> loading;
+
+	/**
+   * Held by the thread that is evicting, loading or writing back this frame
+	 */
+  std::mutex latch;
+
+	/**
+   * Neighbours in the list of frames holding pages of the same file, BufMgr::NO_FRAME at the ends
+	 */
+  FrameId fileNext, filePrev;
 
 	/**
    * Initialize buffer frame for a new user
@@ -71,6 +101,7 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+		loading = false;
   };
 
 	/**
@@ -112,6 +143,7 @@ class BufDesc {
   BufDesc()
 	{
   	Clear();
+    fileNext = filePrev = ~(FrameId) 0;
   }
 };
 
@@ -124,24 +156,29 @@ struct BufStats
 	/**
    * Total number of accesses to buffer pool
 	 */
-  int accesses;
+  std::atomic<int> accesses;
 
 	/**
    * Number of pages read from disk (including allocs)
 	 */
-  int diskreads;
+  std::atomic<int> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<int> diskwrites;
+
+	/**
+   * Number of write-backs by the background writer that failed, leaving the page dirty
+	 */
+  std::atomic<int> writerfailures;
 
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = diskwrites = writerfailures = 0;
   }
       
 	/**
@@ -154,8 +191,255 @@ struct BufStats
 };
 
 
+/**
+* @brief Kinds of bulk access a BufferAccessStrategy can be created for
+*/
+enum class AccessStrategyType
+{
+	/**
+   * Large sequential scan; pages are read once and not needed again
+	 */
+  BULK_READ,
+
+	/**
+   * Bulk load through allocPage(); pages are written once and then left alone
+	 */
+  BULK_WRITE
+};
+
+
+/**
+* @brief Confines a bulk scan or load to a small private ring of buffer frames
+*
+* Passed to BufMgr::readPage() or BufMgr::allocPage(), a strategy makes the pages they
+* bring in recycle a ring of frames of their own instead of competing for the whole
+* pool, so one large scan cannot evict the working set of everybody else.  The ring is
+* filled from the pool on first use.  After that each miss reuses the next ring frame,
+* writing it back first if it is dirty, unless the frame is pinned or another reader has
+* used its page since the strategy loaded it; such a frame is left to the pool and
+* replaced in the ring by a normal allocation.
+*
+* A strategy belongs to one thread and one BufMgr, and must not be used once that
+* BufMgr has been destroyed.
+*/
+class BufferAccessStrategy
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Ring size used for BULK_READ when none is given (256 KB of pages)
+	 */
+  static const std::uint32_t DEFAULT_BULK_READ_RING = 32;
+
+	/**
+   * Ring size used for BULK_WRITE when none is given (2 MB of pages)
+	 */
+  static const std::uint32_t DEFAULT_BULK_WRITE_RING = 256;
+
+	/**
+   * Constructor of BufferAccessStrategy class
+	 *
+	 * @param type   	Kind of bulk access
+	 * @param ringSize	Number of frames in the ring, 0 for the default of the type.  BufMgr
+	 *               	never lets a ring grow past an eighth of the pool.
+	 */
+  BufferAccessStrategy(AccessStrategyType type, std::uint32_t ringSize = 0)
+    : type(type),
+      ringSize(ringSize != 0 ? ringSize
+               : (type == AccessStrategyType::BULK_READ ? DEFAULT_BULK_READ_RING : DEFAULT_BULK_WRITE_RING)),
+      current(0)
+  {
+  }
+
+	/**
+   * Returns the kind of bulk access this strategy was created for
+	 */
+  AccessStrategyType getType() const
+  {
+    return type;
+  }
+
+ private:
+	/**
+   * Kind of bulk access
+	 */
+  AccessStrategyType type;
+
+	/**
+   * Requested number of frames in the ring
+	 */
+  std::uint32_t ringSize;
+
+	/**
+   * Frames of the ring, in the order they are reused
+	 */
+  std::vector<FrameId> ring;
+
+	/**
+   * Index in ring of the frame reused most recently
+	 */
+  std::uint32_t current;
+};
+
+
+/**
+* @brief Sequential access detector for one file, used to drive read-ahead
+*/
+struct ReadAheadStream
+{
+	/**
+   * Id of the file whose accesses are being followed, 0 if none
+	 */
+  FileId fileId;
+
+	/**
+   * Page read most recently
+	 */
+  PageId lastPage;
+
+	/**
+   * First page not yet queued for read-ahead
+	 */
+  PageId nextPage;
+
+	/**
+   * Number of pages to read ahead of lastPage, 0 until the access pattern is sequential
+	 */
+  std::uint32_t window;
+
+	/**
+   * Protects the other members
+	 */
+  std::mutex latch;
+
+	/**
+   * Constructor of ReadAheadStream class
+	 */
+  ReadAheadStream()
+    : fileId(0), lastPage(Page::INVALID_NUMBER), nextPage(Page::INVALID_NUMBER), window(0)
+  {
+  }
+};
+
+
+/**
+* @brief Owns one pin of a page in the buffer pool
+*
+* Returned by the PageHandle overloads of BufMgr::readPage() and BufMgr::allocPage().
+* The handle remembers the frame the page was pinned in and unpins it from there when
+* it is destroyed or released, without looking the page up again, so a page cannot be
+* left pinned by mistake.  Handles can be moved but not copied.  A handle must not
+* outlive the BufMgr it came from.
+*/
+class PageHandle
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Constructs an empty handle that holds no pin
+	 */
+  PageHandle();
+
+	/**
+   * Takes over the pin held by another handle, leaving it empty
+	 */
+  PageHandle(PageHandle&& other);
+
+	/**
+   * Releases the pin held by this handle, if any, and takes over the one held by another
+	 */
+  PageHandle& operator=(PageHandle&& other);
+
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator=(const PageHandle&) = delete;
+
+	/**
+   * Destructor of PageHandle class.  Releases the pin, if any.
+	 */
+  ~PageHandle();
+
+	/**
+   * Returns true if the handle holds a pin
+	 */
+  explicit operator bool() const
+  {
+    return bufMgr != NULL;
+  }
+
+	/**
+   * Returns the pinned page, or NULL for an empty handle
+	 */
+  Page* get() const;
+
+  Page* operator->() const
+  {
+    return get();
+  }
+
+  Page& operator*() const
+  {
+    return *get();
+  }
+
+	/**
+   * Returns the number of the pinned page in its file, or
+   * Page::INVALID_NUMBER if the handle pins no page
+	 */
+  PageId pageNo() const;
+
+	/**
+   * Returns the frame the page is pinned in
+	 */
+  FrameId frameNo() const
+  {
+    return frame;
+  }
+
+	/**
+   * Records that the page has been modified, so that it is unpinned dirty
+	 */
+  void markDirty()
+  {
+    dirty = true;
+  }
+
+	/**
+   * Unpins the page now, leaving the handle empty.  Does nothing for an empty handle.
+	 */
+  void release();
+
+ private:
+	/**
+   * Constructor used by BufMgr for a frame it has just pinned
+	 */
+  PageHandle(BufMgr* bufMgr, FrameId frame);
+
+	/**
+   * Buffer manager the pin belongs to, NULL for an empty handle
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * Frame the page is pinned in
+	 */
+  FrameId frame;
+
+	/**
+   * True if the page is to be unpinned dirty
+	 */
+  bool dirty;
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* BufMgr may be shared by many threads.  The (File, page) to frame mapping is split
+* into partitions, each with its own hash table and latch, so pins of pages in
+* different partitions do not contend.  Disk I/O is only ever done while holding the
+* latch of the single frame involved.
 */
 class BufMgr 
 {
@@ -163,17 +447,193 @@ class BufMgr
 	/**
    * Current position of clockhand in our buffer pool
 	 */
-  FrameId clockHand;
+  std::atomic<FrameId> clockHand;
 
 	/**
    * Number of frames in the buffer pool
 	 */
   std::uint32_t numBufs;
+
+	/**
+   * Number of hash table partitions (a power of two)
+	 */
+  std::uint32_t numPartitions;
 	
 	/**
-   * Hash table mapping (File, page) to frame
+   * Hash tables mapping (File, page) to frame, one per partition
+	 */
+  BufHashTbl **hashTables;
+
+	/**
+   * Latches protecting each hash table partition and the pin counts of the frames it maps
+	 */
+  std::mutex *hashLatches;
+
+	/**
+   * Replacement policy in use, NULL for the built in clock
+	 */
+  Replacer *replacer;
+
+	/**
+   * Background writer thread, if one has been started
+	 */
+  std::thread writerThread;
+
+	/**
+   * True while the background writer should keep running
+	 */
+  bool writerRunning;
+
+	/**
+   * Number of clean, evictable frames the background writer keeps ahead of the clock hand
+	 */
+  std::uint32_t writerCleanTarget;
+
+	/**
+   * Protects writerRunning and writerCleanTarget
+	 */
+  std::mutex writerLatch;
+
+	/**
+   * Wakes the background writer up early when a foreground thread had to write a victim itself
+	 */
+  std::condition_variable writerWakeup;
+
+	/**
+   * Number of sequential access detectors; files are assigned to them by hash
+	 */
+  static const std::uint32_t NUM_READ_AHEAD_STREAMS = 64;
+
+	/**
+   * Largest read-ahead window in pages, 0 if read-ahead is off
+	 */
+  std::atomic<std::uint32_t> readAheadWindow;
+
+	/**
+   * Sequential access detectors
+	 */
+  ReadAheadStream readAheadStreams[NUM_READ_AHEAD_STREAMS];
+
+	/**
+   * Thread reading queued pages into the pool, if read-ahead is on
+	 */
+  std::thread readAheadThread;
+
+	/**
+   * True while the read-ahead thread should keep running
+	 */
+  bool readAheadRunning;
+
+	/**
+   * Pages waiting to be read ahead
+	 */
+  std::deque<PageKey> readAheadQueue;
+
+	/**
+   * Id of the file the read-ahead thread is reading, 0 if it is idle
+	 */
+  FileId readAheadCurrent;
+
+	/**
+   * Protects readAheadRunning, readAheadQueue and readAheadCurrent
+	 */
+  std::mutex readAheadLatch;
+
+	/**
+   * Signalled when pages are queued or the read-ahead thread finishes a page
+	 */
+  std::condition_variable readAheadWakeup;
+
+	/**
+   * Most read requests a BufMgr keeps in flight at once
+	 */
+  static const std::uint32_t IO_QUEUE_DEPTH = 64;
+
+	/**
+   * Most queued pages the read-ahead thread reads in one go; it holds the latches of all
+   * their frames until the last one is in
+	 */
+  static const std::uint32_t READ_AHEAD_BATCH = 16;
+
+	/**
+   * Engine that batched misses and read-ahead are read through
 	 */
-  BufHashTbl *hashTable;
+  IoEngine *ioEngine;
+
+	/**
+	 * Returns the frame holding the given page, reading it in on a miss.  The frame is
+	 * returned pinned.
+	 *
+	 * @param file   			File object
+	 * @param pageNo  		Page number in the file
+	 * @param onlyIfAbsent	If true and the page is already in the pool, return numBufs without pinning it
+	 * @param strategy	If not NULL, a miss is given a frame from the strategy's ring
+	 * @return  					Frame holding the page
+	 */
+  FrameId fetchPage(File* file, const PageId pageNo, const bool onlyIfAbsent, BufferAccessStrategy* strategy);
+
+	/**
+	 * Feeds a page access to the file's sequential access detector, queueing read-ahead
+	 * when the accesses are consecutive.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number just read
+	 */
+  void noteAccess(File* file, const PageId pageNo);
+
+	/**
+	 * Body of the read-ahead thread.  Reads queued pages into the pool, unpinned.
+	 */
+  void readAheadWorker();
+
+	/**
+	 * Reads the given pages into the pool, unpinned, skipping those already resident.
+	 * Used by the read-ahead thread; pages that cannot be read, or for which no frame is
+	 * free, are left out without complaint.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers in the file
+	 */
+  void prefetchPages(File* file, std::vector<PageId> pageNos);
+
+	/**
+	 * Reads missing pages into frames claimed for them with allocBuf().  Each page is
+	 * mapped first, unless another thread has read it in meanwhile, in which case its
+	 * frame is given back.  Then each run of consecutive page numbers is read with one
+	 * request to the I/O engine, all runs in flight together, and a run that cannot be
+	 * read is unmapped again.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Distinct page numbers in ascending order
+	 * @param frames	The claimed frames, one per page.  Returns the frame now holding each
+	 *              	page, pinned once, or numBufs if the page was not loaded.
+	 * @throws  			The first error a run hit, once all runs are done with
+	 */
+  void loadPages(File* file, const std::vector<PageId>& pageNos, std::vector<FrameId>& frames);
+
+	/**
+	 * Pins a frame holding a page of the file and returns the File object it was read
+	 * through.  The pin keeps that object in use until the caller unpins the frame.
+	 *
+	 * @param fileId 	Id of the file
+	 * @param frameNo	Frame pinned returned via this reference
+	 * @return  			File object, or NULL if no page of the file could be pinned
+	 */
+  File* pinResidentFile(const FileId fileId, FrameId& frameNo);
+
+	/**
+	 * Drops queued read-ahead for a file and waits for any read of it in progress.
+	 *
+	 * @param file   	File object
+	 */
+  void cancelReadAhead(const File* file);
+
+	/**
+	 * Body of the background writer thread.  Walks the frames the clock hand will reach
+	 * next and writes back those that are dirty, unpinned and not recently referenced,
+	 * until writerCleanTarget clean evictable frames are waiting ahead of the hand.
+	 */
+  void backgroundWriter();
 
 	/**
    * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
@@ -187,27 +647,143 @@ class BufMgr
 
 	/**
    * Advance clock to next frame in the buffer pool
+	 *
+	 * @return  			Frame the clock hand now points to
+	 */
+  FrameId advanceClock();
+
+	/**
+	 * Allocate a free frame.  The frame is returned invalid, unmapped and with its latch
+	 * held; the caller must unlock it once the frame has been set up.
+	 *
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param claimed 	Frames the caller already holds for the same batch, whose latches it
+	 *                	owns; they are passed over rather than tried again
+	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void advanceClock();
+  void allocBuf(FrameId & frame, const std::vector<FrameId>& claimed = std::vector<FrameId>());
 
 	/**
-	 * Allocate a free frame.  
+	 * Allocate a frame from a strategy's ring, falling back to allocBuf() while the ring
+	 * is being filled or when its next frame cannot be reused.  The frame is returned as
+	 * by allocBuf().
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param strategy	Strategy whose ring to use
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocRingBuf(FrameId & frame, BufferAccessStrategy* strategy);
+
+	/**
+	 * Removes the page held by a valid, unpinned frame from the pool, writing it back
+	 * first if it is dirty.  The caller must hold the frame latch.
+	 *
+	 * @param frameNo Frame to evict
+	 * @return  			False if the frame was pinned again and was left alone
+	 */
+  bool evictFrame(const FrameId frameNo);
+
+	/**
+	 * Drops a pin on a frame the caller knows it has pinned, without going through the
+	 * hash table.  Used by PageHandle.
+	 *
+	 * @param frameNo Pinned frame
+	 * @param dirty		True if the page needs to be marked dirty
+	 */
+  void unPinFrame(const FrameId frameNo, const bool dirty);
+
+	/**
+	 * Marks the end of a per-file frame list
+	 */
+  static const FrameId NO_FRAME = ~(FrameId) 0;
+
+	/**
+   * First frame of the list of frames holding pages of each file, by file id
+	 */
+  std::unordered_map<FileId, FrameId> fileFrames;
+
+	/**
+   * Protects fileFrames and the list links in the frame descriptors.  Taken after the
+   * partition latches.
+	 */
+  std::mutex fileFramesLatch;
+
+	/**
+	 * Adds a frame that has just been Set() to the list of its file.  The caller must
+	 * hold the frame's partition latch.
+	 *
+	 * @param frameNo Frame to add
+	 */
+  void linkFrame(const FrameId frameNo);
+
+	/**
+	 * Removes a frame from the list of its file before its page is unmapped.  The caller
+	 * must hold the frame's partition latch.
+	 *
+	 * @param frameNo Frame to remove
+	 */
+  void unlinkFrame(const FrameId frameNo);
+
+  friend class PageHandle;
+
+	/**
+	 * Returns the hash table partition that (file, pageNo) belongs to.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Partition number between 0 and numPartitions-1
+	 */
+  std::uint32_t partitionOf(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Returns the hash table partition that (fileId, pageNo) belongs to.
+	 *
+	 * @param fileId 	Id of the file
+	 * @param pageNo  Page number in the file
+	 * @return  			Partition number between 0 and numPartitions-1
+	 */
+  std::uint32_t partitionOf(const FileId fileId, const PageId pageNo) const;
+
+	/**
+	 * Waits for a frame that was just pinned through the hash table to finish loading.
+	 * If the load failed the pin is dropped again.
+	 *
+	 * @param frameNo Pinned frame
+	 * @return  			True if the frame holds a valid page
+	 */
+  bool waitForLoad(const FrameId frameNo);
+
+	/**
+	 * Writes the page held by a dirty, unpinned frame back to its file.  The caller must
+	 * hold the frame latch.  The page is copied out under the partition latch, so other
+	 * threads may pin the frame again while the write is in progress.
+	 *
+	 * @param frameNo Frame to write back
+	 * @return  			False if the frame was pinned and nothing was written
+	 * @throws  			Whatever the write threw, with the frame marked dirty again
+	 */
+  bool cleanFrame(const FrameId frameNo);
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Alignment of the buffer pool in bytes, enough for frames to be read and written
+   * with direct I/O
+	 */
+  static const std::size_t POOL_ALIGNMENT = File::DIRECT_ALIGNMENT;
+
+	/**
+   * Actual buffer pool from which frames are allocated.  A single POOL_ALIGNMENT-aligned
+   * block; since Page::SIZE is a multiple of it, every frame is aligned as well.
 	 */
   Page* bufPool;
 
 	/**
    * Constructor of BufMgr class
+	 *
+	 * @param bufs   	Number of frames in the buffer pool
+	 * @param policy  Page replacement policy used to choose victim frames
 	 */
-  BufMgr(std::uint32_t bufs);
+  BufMgr(std::uint32_t bufs, ReplacementPolicy policy = ReplacementPolicy::CLOCK);
 	
 	/**
    * Destructor of BufMgr class
@@ -222,8 +798,46 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number in the file to be read
 	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy	If not NULL, a miss reads the page into the strategy's ring instead of the shared pool.
+	 *              	Such reads do not trigger read-ahead.
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  void readPage(File* file, const PageId PageNo, Page*& page, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads the given page like readPage() above, returning a handle that keeps it pinned
+	 * until the handle is destroyed or released.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy	If not NULL, a miss reads the page into the strategy's ring instead of the shared pool.
+	 * @return  			Handle holding the pin
+	 */
+  PageHandle readPage(File* file, const PageId PageNo, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Reads a batch of pages from the file, pinning each once per time it is listed.
+	 * Resident pages are pinned first; frames for the rest are claimed together and the
+	 * missing pages are read through the I/O engine, each run of consecutive page numbers
+	 * with a single request and all runs at the same time.  If any page cannot be read or
+	 * no frame is left, nothing stays pinned and the exception is passed on.
+	 *
+	 * @param file   	File object
+	 * @param PageNos Page numbers in the file to be read
+	 * @param pages  	Pointers to the pages, in the order of PageNos, returned via this reference
+	 * @throws BufferExceededException If there are not enough unpinned frames for the batch
+	 */
+  void readPages(File* file, const std::vector<PageId>& PageNos, std::vector<Page*>& pages);
+
+	/**
+	 * Unpins a batch of pages, as by calling unPinPage() on each, taking each partition
+	 * latch only once.
+	 *
+	 * @param file   	File object
+	 * @param PageNos Page numbers to unpin; list a page more than once to drop more than one pin
+	 * @param dirty		True if the pages need to be marked dirty
+   * @throws  PageNotPinnedException If a page is not pinned; pages met before it are unpinned
+	 */
+  void unPinPages(File* file, const std::vector<PageId>& PageNos, const bool dirty);
 
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
@@ -242,8 +856,36 @@ class BufMgr
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
 	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param strategy	If not NULL, the page is given a frame from the strategy's ring instead of the shared pool.
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page, BufferAccessStrategy* strategy = NULL); 
+
+	/**
+	 * Allocates a new, empty page like allocPage() above, returning a handle that keeps it
+	 * pinned until the handle is destroyed or released.  New pages are not dirty until
+	 * PageHandle::markDirty() is called.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param strategy	If not NULL, the page is given a frame from the strategy's ring instead of the shared pool.
+	 * @return  			Handle holding the pin
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  PageHandle allocPage(File* file, PageId &PageNo, BufferAccessStrategy* strategy = NULL);
+
+	/**
+	 * Allocates a run of new, empty pages with consecutive page numbers at the end of the
+	 * file, with one update of the file header and one write (see File::allocatePages()),
+	 * and pins each in a frame of its own.  Frames for the whole run are claimed first;
+	 * if there are not enough, nothing is allocated.
+	 *
+	 * @param file   	File object
+	 * @param count		Number of pages to allocate
+	 * @param firstPageNo	Number of the first page allocated, returned via this reference
+	 * @param pages  	Pointers to the new pages, in page number order, returned via this reference
+	 * @param preallocate	True to have the file system reserve the space for the run in one piece
+	 * @throws BufferExceededException If there are not enough unpinned frames for the run
+	 */
+  void allocPages(File* file, const std::uint32_t count, PageId &firstPageNo, std::vector<Page*>& pages, const bool preallocate = false);
 
 	/**
 	 * Check whether the file is open. If file open, then write the page into the buffer pool.
@@ -255,7 +897,8 @@ class BufMgr
 
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Writes out all dirty pages of the file to disk, then calls File::sync() so they are
+	 * written together and made as durable as the file's durability mode asks.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
 	 * Otherwise Error returned.
 	 *
@@ -263,7 +906,7 @@ class BufMgr
    * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
    * @throws BadBufferException If any frame allocated to the file is found to be invalid
 	 */
-  void flushFile(const File* file);
+  void flushFile(File* file);
 
 	/**
 	 * Delete page from file and also from buffer pool if present.
@@ -275,6 +918,37 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Starts a background thread that writes back dirty frames before the clock hand
+	 * reaches them, so that allocating a frame rarely has to wait for a disk write.
+	 * Calling it again while the writer runs just changes the target.
+	 * Under replacement policies other than CLOCK the writer walks the frames in order and
+	 * cleans any unpinned dirty frame.  A write that fails is counted in
+	 * BufStats::writerfailures and its frame stays dirty, so that a later flushFile()
+	 * retries it and throws the error.
+	 *
+	 * @param cleanTarget	Number of clean evictable frames to keep ahead of the clock hand
+	 */
+  void startBackgroundWriter(std::uint32_t cleanTarget);
+
+	/**
+	 * Stops the background writer and waits for it to finish its current write.
+	 * Does nothing if no writer is running.
+	 */
+  void stopBackgroundWriter();
+
+	/**
+	 * Turns sequential read-ahead on or off.  While it is on, readPage() watches for runs
+	 * of consecutive page numbers in each file and has a background thread read the
+	 * following pages into free frames before they are asked for.  The window starts at 4
+	 * pages and doubles while the run continues; a non-consecutive read resets it.
+	 * Read-ahead pages are left unpinned, and a file's queued pages are dropped once
+	 * none of its pages are left in the pool.
+	 *
+	 * @param maxWindow	Largest number of pages to read ahead, 0 to turn read-ahead off
+	 */
+  void setReadAhead(std::uint32_t maxWindow);
+
+	/**
    * Print member variable values. 
 	 */
   void  printSelf();
@@ -0,0 +1,214 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "checksum.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define BADGERDB_CRC32C_SSE42 1
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * The Castagnoli polynomial, bit-reversed as the crc32 instruction uses it.
+ */
+const std::uint32_t CASTAGNOLI = 0x82f63b78;
+
+/**
+ * @brief CRC of every byte value followed by 0 to 7 zero bytes, for
+ *        crc32cPortable() to take eight bytes a step.
+ */
+struct CrcTable {
+  std::uint32_t entries[8][256];
+
+  CrcTable() {
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      std::uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit) {
+        crc = (crc >> 1) ^ (CASTAGNOLI & (0 - (crc & 1)));
+      }
+      entries[0][i] = crc;
+    }
+    for (std::uint32_t i = 0; i < 256; ++i) {
+      for (int zeros = 1; zeros < 8; ++zeros) {
+        const std::uint32_t crc = entries[zeros - 1][i];
+        entries[zeros][i] = entries[0][crc & 0xff] ^ (crc >> 8);
+      }
+    }
+  }
+};
+
+#ifdef BADGERDB_CRC32C_SSE42
+/**
+ * Lengths of the blocks crc32cSse42() checksums three at a time, sized so a
+ * page takes one long and two short rounds.
+ */
+const std::size_t LONG_BLOCK = 2048;
+const std::size_t SHORT_BLOCK = 256;
+
+/**
+ * Applies a GF(2) matrix, one column per bit, to a vector of 32 bits.
+ */
+std::uint32_t matrixTimes(const std::uint32_t* matrix, std::uint32_t vector) {
+  std::uint32_t sum = 0;
+  for (; vector != 0; vector >>= 1, ++matrix) {
+    if (vector & 1) {
+      sum ^= *matrix;
+    }
+  }
+  return sum;
+}
+
+/**
+ * @brief Tables that move a CRC past a block of zeros in four lookups, so the
+ *        CRCs of consecutive blocks computed apart can be joined.
+ */
+struct ShiftTable {
+  std::uint32_t entries[4][256];
+
+  explicit ShiftTable(std::size_t length) {
+    // the operator for one zero bit, then squared until it covers length bytes
+    std::uint32_t odd[32];
+    std::uint32_t even[32];
+    odd[0] = CASTAGNOLI;
+    for (int n = 1; n < 32; ++n) {
+      odd[n] = (std::uint32_t) 1 << (n - 1);
+    }
+    square(even, odd);
+    square(odd, even);
+    std::uint32_t* op = odd;
+    for (;;) {
+      square(even, odd);
+      length >>= 1;
+      op = even;
+      if (length == 0) {
+        break;
+      }
+      square(odd, even);
+      length >>= 1;
+      op = odd;
+      if (length == 0) {
+        break;
+      }
+    }
+    for (std::uint32_t n = 0; n < 256; ++n) {
+      for (int byte = 0; byte < 4; ++byte) {
+        entries[byte][n] = matrixTimes(op, n << (8 * byte));
+      }
+    }
+  }
+
+  std::uint32_t shift(const std::uint32_t crc) const {
+    return entries[0][crc & 0xff] ^ entries[1][(crc >> 8) & 0xff] ^
+        entries[2][(crc >> 16) & 0xff] ^ entries[3][crc >> 24];
+  }
+
+  static void square(std::uint32_t* result, const std::uint32_t* matrix) {
+    for (int n = 0; n < 32; ++n) {
+      result[n] = matrixTimes(matrix, matrix[n]);
+    }
+  }
+};
+
+/**
+ * Runs the crc32 instruction over three blocks of <block> bytes at once, so
+ * each waits out the latency of the others, and joins the three CRCs.
+ */
+__attribute__((target("sse4.2")))
+std::uint64_t crc32cTriple(std::uint64_t crc, const unsigned char*& bytes,
+                           const std::size_t block, const ShiftTable& table) {
+  std::uint64_t crc1 = 0;
+  std::uint64_t crc2 = 0;
+  for (std::size_t i = 0; i < block; i += sizeof(std::uint64_t)) {
+    std::uint64_t words[3];
+    std::memcpy(&words[0], bytes + i, sizeof(std::uint64_t));
+    std::memcpy(&words[1], bytes + block + i, sizeof(std::uint64_t));
+    std::memcpy(&words[2], bytes + 2 * block + i, sizeof(std::uint64_t));
+    crc = _mm_crc32_u64(crc, words[0]);
+    crc1 = _mm_crc32_u64(crc1, words[1]);
+    crc2 = _mm_crc32_u64(crc2, words[2]);
+  }
+  bytes += 3 * block;
+  crc = table.shift((std::uint32_t) crc) ^ crc1;
+  return table.shift((std::uint32_t) crc) ^ crc2;
+}
+
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cSse42(const unsigned char* bytes, std::size_t length,
+                          const std::uint32_t crc) {
+  static const ShiftTable long_shift(LONG_BLOCK);
+  static const ShiftTable short_shift(SHORT_BLOCK);
+  std::uint64_t crc64 = ~crc;
+  for (; length >= 3 * LONG_BLOCK; length -= 3 * LONG_BLOCK) {
+    crc64 = crc32cTriple(crc64, bytes, LONG_BLOCK, long_shift);
+  }
+  for (; length >= 3 * SHORT_BLOCK; length -= 3 * SHORT_BLOCK) {
+    crc64 = crc32cTriple(crc64, bytes, SHORT_BLOCK, short_shift);
+  }
+  for (; length >= sizeof(std::uint64_t); length -= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+    bytes += sizeof(word);
+  }
+  std::uint32_t crc32 = (std::uint32_t) crc64;
+  for (; length > 0; --length) {
+    crc32 = _mm_crc32_u8(crc32, *bytes++);
+  }
+  return ~crc32;
+}
+#endif
+
+}
+
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc) {
+#ifdef BADGERDB_CRC32C_SSE42
+  if (crc32cInHardware()) {
+    return crc32cSse42(static_cast<const unsigned char*>(data), length, crc);
+  }
+#endif
+  return crc32cPortable(data, length, crc);
+}
+
+std::uint32_t crc32cPortable(const void* data, const std::size_t length,
+                             const std::uint32_t crc) {
+  static const CrcTable table;
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  std::uint32_t crc32 = ~crc;
+  std::size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    // bytes in order, so this does not depend on the byte order of words
+    const std::uint32_t low = crc32 ^ (bytes[i] | bytes[i + 1] << 8 |
+                                       bytes[i + 2] << 16 |
+                                       (std::uint32_t) bytes[i + 3] << 24);
+    crc32 = table.entries[7][low & 0xff] ^ table.entries[6][(low >> 8) & 0xff] ^
+        table.entries[5][(low >> 16) & 0xff] ^ table.entries[4][low >> 24] ^
+        table.entries[3][bytes[i + 4]] ^ table.entries[2][bytes[i + 5]] ^
+        table.entries[1][bytes[i + 6]] ^ table.entries[0][bytes[i + 7]];
+  }
+  for (; i < length; ++i) {
+    crc32 = table.entries[0][(crc32 ^ bytes[i]) & 0xff] ^ (crc32 >> 8);
+  }
+  return ~crc32;
+}
+
+bool crc32cInHardware() {
+#ifdef BADGERDB_CRC32C_SSE42
+  static const bool sse42 = __builtin_cpu_supports("sse4.2");
+  return sse42;
+#else
+  return false;
+#endif
+}
+
+}
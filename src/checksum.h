@@ -0,0 +1,45 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Computes the CRC-32C (Castagnoli) of a block of bytes.  Uses the SSE4.2
+ * crc32 instruction, on three parts of the block at once, when the processor
+ * has it, and crc32cPortable() otherwise.
+ *
+ * @param data    Bytes to checksum.
+ * @param length  Number of bytes.
+ * @param crc     CRC of the bytes before these, to checksum a block in parts.
+ * @return  CRC of all the bytes so far.
+ */
+std::uint32_t crc32c(const void* data, const std::size_t length,
+                     const std::uint32_t crc = 0);
+
+/**
+ * Computes the same CRC as crc32c() from tables, eight bytes a step, on any
+ * processor.
+ *
+ * @param data    Bytes to checksum.
+ * @param length  Number of bytes.
+ * @param crc     CRC of the bytes before these.
+ * @return  CRC of all the bytes so far.
+ */
+std::uint32_t crc32cPortable(const void* data, const std::size_t length,
+                             const std::uint32_t crc = 0);
+
+/**
+ * Returns true if crc32c() runs on the crc32 instruction.
+ */
+bool crc32cInHardware();
+
+}
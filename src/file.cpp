@@ -7,31 +7,206 @@
 
 #include "file.h"
 
-#include <fstream>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <cerrno>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <cassert>
+#include <new>
 
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "checksum.h"
+#include "exceptions/corrupt_page_exception.h"
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
+#include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/read_only_file_exception.h"
 #include "file_iterator.h"
+#include "io_engine.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+namespace {
+
+/**
+ * Scratch memory aligned for direct I/O, released when it goes out of scope.
+ */
+class AlignedBuffer {
+ public:
+  explicit AlignedBuffer(const std::size_t length) : data_(NULL) {
+    if (::posix_memalign(&data_, File::DIRECT_ALIGNMENT, length) != 0) {
+      throw std::bad_alloc();
+    }
+  }
+
+  ~AlignedBuffer() { ::free(data_); }
+
+  char* data() const { return static_cast<char*>(data_); }
+
+ private:
+  AlignedBuffer(const AlignedBuffer&);
+  AlignedBuffer& operator=(const AlignedBuffer&);
+
+  void* data_;
+};
+
+bool testBit(const std::vector<std::uint64_t>& bits, const PageId bit) {
+  return (bits[bit / 64] >> (bit % 64)) & 1;
+}
+
+void setBit(std::vector<std::uint64_t>& bits, const PageId bit) {
+  bits[bit / 64] |= (std::uint64_t) 1 << (bit % 64);
+}
+
+void clearBit(std::vector<std::uint64_t>& bits, const PageId bit) {
+  bits[bit / 64] &= ~((std::uint64_t) 1 << (bit % 64));
+}
+
+/**
+ * Returns the first bit at or after <from> and before <limit> that is set (or
+ * clear, if <value> is false), or <limit> if there is none.
+ */
+PageId findBit(const std::vector<std::uint64_t>& bits, PageId from,
+               const PageId limit, const bool value) {
+  while (from < limit) {
+    std::uint64_t word = value ? bits[from / 64] : ~bits[from / 64];
+    word &= ~(std::uint64_t) 0 << (from % 64);
+    if (word != 0) {
+      return std::min<PageId>(from - from % 64 + __builtin_ctzll(word), limit);
+    }
+    from += 64 - from % 64;
+  }
+  return limit;
+}
+
+/**
+ * Returns the CRC-32C of a page as laid out on disk, leaving out the checksum
+ * field in its header.
+ */
+std::uint32_t pageChecksum(const void* page) {
+  const char* bytes = static_cast<const char*>(page);
+  const std::size_t field = offsetof(PageHeader, checksum);
+  const std::size_t rest = field + sizeof(std::uint32_t);
+  return crc32c(bytes + rest, Page::SIZE - rest, crc32c(bytes, field));
+}
+
+}
+
+const std::size_t File::DIRECT_ALIGNMENT;
+const std::uint32_t File::FORMAT_MAGIC;
+const std::uint32_t File::FORMAT_VERSION;
+const std::size_t File::WRITE_BATCH_PAGES;
+const PageId File::PAGES_PER_BITMAP;
+const std::uint32_t File::BITMAP_VERSION;
+const std::uint32_t File::CHECKSUM_VERSION;
+const std::uint32_t File::SLOT_BITMAP_VERSION;
+const std::uint32_t File::FRAGMENTATION_VERSION;
+const std::size_t File::BITMAP_OFFSET;
+const std::size_t File::BITMAP_WORDS;
+
+
+File::IdMap File::file_ids_;
+File::DescriptorMap File::open_descriptors_;
 File::CountMap File::open_counts_;
+File::LatchMap File::open_latches_;
 
-File File::create(const std::string& filename) {
-  return File(filename, true /* create_new */);
+File File::create(const std::string& filename, const FileIoMode mode) {
+  return File(filename, true /* create_new */, mode);
 }
 
-File File::open(const std::string& filename) {
-  return File(filename, false /* create_new */);
+File File::open(const std::string& filename, const FileIoMode mode) {
+  return File(filename, false /* create_new */, mode, true /* old_layout */);
+}
+
+File File::openMapped(const std::string& filename) {
+  File file(filename, false /* create_new */);
+  {
+    // the mapping only shows what is on disk
+    std::lock_guard<std::recursive_mutex> guard(*file.latch_);
+    file.writePending();
+  }
+  struct stat status;
+  if (::fstat(file.descriptor_->fd, &status) != 0) {
+    throw FileIOException(filename, "stat", errno);
+  }
+  void* base = ::mmap(NULL, status.st_size, PROT_READ, MAP_SHARED,
+                      file.descriptor_->fd, 0);
+  if (base == MAP_FAILED) {
+    throw FileIOException(filename, "map", errno);
+  }
+  file.mapping_.reset(new Mapping(static_cast<const char*>(base),
+                                  status.st_size));
+  return file;
+}
+
+void File::upgrade(const std::string& filename) {
+  if (!exists(filename)) {
+    throw FileNotFoundException(filename);
+  }
+  if (isOpen(filename)) {
+    throw FileOpenException(filename);
+  }
+  const std::string temporary = filename + ".upgrade";
+  {
+    File old_file(filename, false /* create_new */, FileIoMode::BUFFERED,
+                  true /* old_layout */);
+    std::uint32_t tag[2];
+    old_file.readAt(tag, sizeof(tag), 0 /* offset */);
+    const std::uint32_t version = tag[0] == FORMAT_MAGIC ? tag[1] : 0;
+    if (version == FORMAT_VERSION) {
+      return;
+    }
+    if (exists(temporary)) {
+      // left behind by an upgrade that did not finish
+      std::remove(temporary.c_str());
+    }
+    File new_file(temporary, true /* create_new */);
+    std::lock_guard<std::recursive_mutex> guard(*new_file.latch_);
+    Descriptor& descriptor = *new_file.descriptor_;
+    const PageId num_pages = old_file.readHeader().num_pages;
+    FileHeader header = {num_pages, Page::INVALID_NUMBER /* first_used_page */,
+                         0 /* num_free_pages */,
+                         Page::INVALID_NUMBER /* first_free_page */};
+    new_file.coverPages(header);
+    // free pages are left as holes, which read as cleared pages
+    const off_t length = new_file.pagePosition(header.num_pages);
+    if (::ftruncate(descriptor.fd, length) != 0) {
+      throw FileIOException(temporary, "truncate", errno);
+    }
+    Page page;
+    for (PageId page_number = 1; page_number < num_pages; ++page_number) {
+      if (old_file.readPageHeader(page_number).current_page_number ==
+          Page::INVALID_NUMBER) {
+        ++header.num_free_pages;
+        continue;
+      }
+      // read converts the page
+      old_file.readPage(page_number, page, true /* allow_free */);
+      new_file.writePage(page_number, page);
+      setBit(descriptor.used_pages, page_number);
+    }
+    descriptor.bitmap_dirty.assign(descriptor.bitmap_dirty.size(), true);
+    new_file.writeHeader(header);
+    new_file.flushHeader();
+  }
+  if (std::rename(temporary.c_str(), filename.c_str()) != 0) {
+    throw FileIOException(filename, "rename", errno);
+  }
 }
 
 void File::remove(const std::string& filename) {
@@ -48,32 +223,40 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  const IdMap::const_iterator id = file_ids_.find(filename);
+  return id != file_ids_.end() &&
+         open_counts_.find(id->second) != open_counts_.end();
 }
 
-bool File::exists(const std::string& filename) {
-	std::fstream file(filename);
-	if(file)
-	{
-		file.close();
-		return true;
-	}
+FileId File::internId(const std::string& filename) {
+  const FileId next_id = (FileId) file_ids_.size() + 1;
+  return file_ids_.insert(std::make_pair(filename, next_id)).first->second;
+}
 
-	return false;
+bool File::exists(const std::string& filename) {
+  return ::access(filename.c_str(), R_OK | W_OK) == 0;
 }
 
 File::File(const File& other)
   : filename_(other.filename_),
-    stream_(open_streams_[filename_]) {
-  ++open_counts_[filename_];
+    id_(other.id_),
+    descriptor_(open_descriptors_[id_]),
+    latch_(open_latches_[id_]),
+    mapping_(other.mapping_) {
+  ++open_counts_[id_];
 }
 
 File& File::operator=(const File& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  const std::string filename = rhs.filename_;
+  const FileId id = rhs.id_;
+  const std::shared_ptr<Mapping> mapping = rhs.mapping_;
   close();	//close my file and associate me with the new one
-  filename_ = rhs.filename_;
+  filename_ = filename;
+  id_ = id;
   openIfNeeded(false /* create_new */);
+  mapping_ = mapping;
   return *this;
 }
 
@@ -82,68 +265,58 @@ File::~File() {
 }
 
 Page File::allocatePage() {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
-  if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
-    --header.num_free_pages;
+  allocatePage(new_page);
+  return new_page;
+}
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
+void File::allocatePage(Page& new_page) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  allocateFromBitmap(new_page);
+}
 
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
-  } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+PageId File::allocatePages(const std::vector<Page*>& new_pages,
+                           const bool preallocate) {
+  checkWritable();
+  if (new_pages.empty()) {
+    return Page::INVALID_NUMBER;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  const PageId first_page_number = header.num_pages;
+  header.num_pages += new_pages.size();
+
+  std::vector<struct iovec> iov(new_pages.size());
+  for (std::size_t i = 0; i < new_pages.size(); ++i) {
+    Page& new_page = *new_pages[i];
+    new_page.initialize();
+    new_page.set_page_number(first_page_number + i);
+    if (hasChecksums()) {
+      new_page.header_.checksum = pageChecksum(&new_page);
     }
-    ++header.num_pages;
+    iov[i].iov_base = &new_page;
+    iov[i].iov_len = Page::SIZE;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+
+  if (preallocate &&
+      ::fallocate(descriptor_->fd, 0, pagePosition(first_page_number),
+                  (off_t) new_pages.size() * Page::SIZE) != 0 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    throw FileIOException(filename_, "allocate", errno);
+  }
+  for (std::size_t i = 0; i < iov.size(); i += IOV_MAX) {
+    const int count = (int) std::min<std::size_t>(IOV_MAX, iov.size() - i);
+    writeVector(&iov[i], count, pagePosition(first_page_number + i));
+  }
+  coverPages(header);
+  for (std::size_t i = 0; i < new_pages.size(); ++i) {
+    setBit(descriptor_->used_pages, first_page_number + i);
+    descriptor_->bitmap_dirty[(first_page_number + i) / PAGES_PER_BITMAP] =
+        true;
   }
   writeHeader(header);
-
-  return new_page;
+  return first_page_number;
 }
 
 Page File::readPage(const PageId page_number) const {
@@ -154,90 +327,215 @@ Page File::readPage(const PageId page_number) const {
   return readPage(page_number, false /* allow_free */);
 }
 
+void File::readPage(const PageId page_number, Page& page) const {
+  FileHeader header = readHeader();
+  if (page_number >= header.num_pages) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  readPage(page_number, page, false /* allow_free */);
+}
+
+void File::readPages(const PageId first_page_number,
+                     const std::vector<Page*>& pages) const {
+  FileHeader header = readHeader();
+  if (first_page_number + pages.size() > header.num_pages) {
+    throw InvalidPageException(std::max(first_page_number, header.num_pages),
+                               filename_);
+  }
+  writePendingIn(first_page_number, pages.size());
+
+  // the pages are contiguous on disk, so the run is one vectored read (or a
+  // few, if it has more pages than a single call takes)
+  std::vector<struct iovec> iov(pages.size());
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    iov[i].iov_base = pages[i];
+    iov[i].iov_len = Page::SIZE;
+  }
+  for (std::size_t i = 0; i < iov.size(); i += IOV_MAX) {
+    const int count = (int) std::min<std::size_t>(IOV_MAX, iov.size() - i);
+    readVector(&iov[i], count, pagePosition(first_page_number + i));
+  }
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    verifyPage(first_page_number + i, *pages[i]);
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+    convertRead(*pages[i]);
+  }
+}
+
+void File::startReadPages(IoEngine& engine, const PageId first_page_number,
+                          const std::vector<Page*>& pages,
+                          IoRequest& request) const {
+  FileHeader header = readHeader();
+  if (first_page_number + pages.size() > header.num_pages) {
+    throw InvalidPageException(std::max(first_page_number, header.num_pages),
+                               filename_);
+  }
+  writePendingIn(first_page_number, pages.size());
+
+  request.operation = IoRequest::READ;
+  request.offset = pagePosition(first_page_number);
+  request.buffers.resize(pages.size());
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    request.buffers[i].iov_base = pages[i];
+    request.buffers[i].iov_len = Page::SIZE;
+  }
+  // pages that are not aligned for direct I/O go through the page cache
+  request.fd = descriptorFor(request.buffers.data(), (int) pages.size(),
+                             request.offset);
+  engine.submit(&request);
+}
+
+void File::finishReadPages(const PageId first_page_number,
+                           const std::vector<Page*>& pages,
+                           const IoRequest& request) const {
+  if (request.result < 0) {
+    throw FileIOException(filename_, "read", (int) -request.result);
+  }
+  if ((std::size_t) request.result < request.length()) {
+    throw FileIOException(filename_, "read", 0);
+  }
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    verifyPage(first_page_number + i, *pages[i]);
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+    convertRead(*pages[i]);
+  }
+}
+
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
+  readPage(page_number, page, allow_free);
+  return page;
+}
+
+void File::readPage(const PageId page_number, Page& page,
+                    const bool allow_free) const {
+  // a Page is laid out exactly as on disk, so it is read in one piece
+  if (!readPending(page_number, &page, Page::SIZE)) {
+    readAt(&page, Page::SIZE, pagePosition(page_number));
+  }
+  verifyPage(page_number, page);
   if (!allow_free && !page.isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
+  convertRead(page);
+}
 
-  return page;
+void File::convertRead(Page& page) const {
+  if (descriptor_->page_version != FORMAT_VERSION && page.isUsed()) {
+    convertPage(page, descriptor_->page_version);
+  }
 }
 
-void File::writePage(const Page& new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
-    // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+void File::verifyPage(const PageId page_number, const Page& page) const {
+  if (!hasChecksums() || (!page.isUsed() && page.header_.checksum == 0)) {
+    return;
+  }
+  if (pageChecksum(&page) != page.header_.checksum) {
+    throw CorruptPageException(page_number, filename_);
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
 }
 
-void File::deletePage(const PageId page_number) {
-  FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
+void File::convertPage(Page& page, const std::uint32_t version) {
+  PageHeader& header = page.header_;
+  // where the page header ended and the slot array started
+  const std::size_t old_header_size = version < CHECKSUM_VERSION
+      ? offsetof(PageHeader, checksum)
+      : offsetof(PageHeader, fragmented_free_space);
+  const std::size_t grown = sizeof(PageHeader) - old_header_size;
+  const std::size_t free_space =
+      header.free_space_upper_bound - header.free_space_lower_bound;
+  if (free_space < grown) {
+    throw InsufficientSpaceException(page.page_number(), grown, free_space);
+  }
+  std::memmove(page.data_, reinterpret_cast<char*>(&page) + old_header_size,
+               header.free_space_lower_bound);
+  header.free_space_upper_bound -= grown;
+  header.checksum = 0;
+  header.fragmented_free_space = 0;
+  if (version < SLOT_BITMAP_VERSION) {
+    // the slots as they were, one after another
+    std::vector<PageSlot> slots(header.num_slots);
+    std::memcpy(slots.data(), page.data_, header.free_space_lower_bound);
+    const std::size_t slot_array = Page::slotArraySize(header.num_slots);
+    if (slot_array > header.free_space_upper_bound) {
+      throw InsufficientSpaceException(
+          page.page_number(), slot_array - header.free_space_lower_bound,
+          header.free_space_upper_bound - header.free_space_lower_bound);
+    }
+    std::memset(page.data_, 0, header.free_space_upper_bound);
+    header.free_space_lower_bound = slot_array;
+    for (SlotId i = 1; i <= header.num_slots; ++i) {
+      *page.getSlot(i) = slots[i - 1];
+      if (slots[i - 1].used) {
+        page.setSlotUsed(i, true);
       }
     }
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
-  ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
+  for (SlotId i = page.findSlot(1, true /* used */); i != Page::INVALID_SLOT;
+       i = page.findSlot(i + 1, true /* used */)) {
+    page.getSlot(i)->item_offset -= grown;
   }
-  writePage(page_number, existing_page);
-  writeHeader(header);
+}
+
+void File::writePage(const Page& new_page) {
+  writeAllocatedPage(new_page, NULL);
+}
+
+void File::writePage(const Page& new_page, IoEngine& engine) {
+  writeAllocatedPage(new_page, &engine);
+}
+
+void File::writeAllocatedPage(const Page& new_page, IoEngine* engine) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  // pages are not linked, so nothing on disk needs keeping
+  if (!isAllocated(new_page.page_number())) {
+    throw InvalidPageException(new_page.page_number(), filename_);
+  }
+  writePage(new_page.page_number(), new_page.header_, new_page, engine);
+}
+
+void File::deletePage(const PageId page_number) {
+  checkWritable();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  deleteFromBitmap(page_number);
 }
 
 FileIterator File::begin() {
-  const FileHeader& header = readHeader();
-  return FileIterator(this, header.first_used_page);
+  return FileIterator(this, firstUsedPage());
 }
 
 FileIterator File::end() {
   return FileIterator(this, Page::INVALID_NUMBER);
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const FileIoMode mode, const bool old_layout)
+  : filename_(name),
+    id_(internId(name)) {
+  openIfNeeded(create_new, mode, old_layout);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
     writeHeader(header);
+    flushHeader();
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+void File::openIfNeeded(const bool create_new, const FileIoMode mode,
+                        const bool old_layout) {
+  if (open_counts_.find(id_) != open_counts_.end()) {	//exists an entry already
+    ++open_counts_[id_];
+    descriptor_ = open_descriptors_[id_];
+    latch_ = open_latches_[id_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
+    int flags = O_RDWR;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
@@ -245,25 +543,229 @@ void File::openIfNeeded(const bool create_new) {
         throw FileExistsException(filename_);
       }
       // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
+      flags |= O_CREAT | O_TRUNC;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+    const int fd = ::open(filename_.c_str(), flags, 0644);
+    if (fd < 0) {
+      throw FileIOException(filename_, "open", errno);
+    }
+    descriptor_.reset(new Descriptor(fd));
+    latch_.reset(new std::recursive_mutex());
+    readFormat(create_new, old_layout);
+    open_descriptors_[id_] = descriptor_;
+    open_latches_[id_] = latch_;
+    open_counts_[id_] = 1;
+  }
+  if (mode == FileIoMode::DIRECT) {
+    openDirect();
+  }
+}
+
+void File::readFormat(const bool create_new, const bool old_layout) {
+  static_assert(sizeof(HeaderBlock) <= BITMAP_OFFSET,
+                "header block fields overlap the bitmap");
+  static_assert(PAGES_PER_BITMAP / 8 <= Page::DATA_SIZE,
+                "a bitmap does not fit in a page");
+  Descriptor& descriptor = *descriptor_;
+  std::uint32_t tag[2] = {FORMAT_MAGIC, FORMAT_VERSION};
+  if (!create_new) {
+    readAt(tag, sizeof(tag), 0 /* offset */);
+  }
+  const bool tagged = tag[0] == FORMAT_MAGIC;
+  const bool current = tagged && tag[1] == FORMAT_VERSION;
+  if (!current && (!old_layout || (tagged && tag[1] > FORMAT_VERSION))) {
+    throw FileIOException(filename_, "open", ENOTSUP);
+  }
+  if (tagged) {
+    descriptor.header_offset = sizeof(tag);
+    descriptor.first_page_offset = Page::SIZE;
+  }
+  // otherwise the file is untagged, with a bare header and the pages right
+  // behind it
+
+  if (create_new) {
+    descriptor.version = FORMAT_VERSION;
+    descriptor.used_pages.assign(BITMAP_WORDS, 0);
+    setBit(descriptor.used_pages, 0 /* the header block */);
+    descriptor.bitmap_dirty.assign(1, true);
+  } else if (current) {
+    loadBitmaps();
+  } else {
+    // read-only until upgrade(); pages are found by their headers, so there
+    // are no bitmaps to load
+    descriptor.page_version = tagged ? tag[1] : 0;
+    readAt(&descriptor.header, sizeof(FileHeader), descriptor.header_offset);
+  }
+}
+
+void File::loadBitmaps() {
+  Descriptor& descriptor = *descriptor_;
+  AlignedBuffer block(Page::SIZE);
+  readAt(block.data(), Page::SIZE, 0 /* offset */);
+  HeaderBlock start;
+  std::memcpy(&start, block.data(), sizeof(start));
+  descriptor.version = start.version;
+  descriptor.header = start.header;
+  descriptor.used_pages.assign(BITMAP_WORDS, 0);
+  std::memcpy(&descriptor.used_pages[0], block.data() + BITMAP_OFFSET,
+              PAGES_PER_BITMAP / 8);
+
+  Page page;
+  for (PageId page_number = start.first_bitmap_page;
+       page_number != Page::INVALID_NUMBER;
+       page_number = page.next_page_number()) {
+    readPage(page_number, page, true /* allow_free */);
+    descriptor.bitmap_pages.push_back(page_number);
+    descriptor.used_pages.resize(descriptor.used_pages.size() + BITMAP_WORDS);
+    std::memcpy(&descriptor.used_pages[descriptor.used_pages.size() -
+                                       BITMAP_WORDS],
+                page.data_, PAGES_PER_BITMAP / 8);
+  }
+  descriptor.bitmap_dirty.assign(descriptor.bitmap_pages.size() + 1, false);
+}
+
+void File::coverPages(FileHeader& header) {
+  Descriptor& descriptor = *descriptor_;
+  const std::size_t covered = descriptor.bitmap_pages.size();
+  while (descriptor.used_pages.size() * 64 < header.num_pages) {
+    // the previous bitmap is the one that links to the new page
+    descriptor.bitmap_dirty.back() = true;
+    descriptor.bitmap_pages.push_back(header.num_pages++);
+    descriptor.used_pages.resize(descriptor.used_pages.size() + BITMAP_WORDS);
+    descriptor.bitmap_dirty.push_back(true);
+  }
+  for (std::size_t i = covered; i < descriptor.bitmap_pages.size(); ++i) {
+    setBit(descriptor.used_pages, descriptor.bitmap_pages[i]);
+  }
+}
+
+bool File::isBitmapPage(const PageId page_number) const {
+  const std::vector<PageId>& bitmap_pages = descriptor_->bitmap_pages;
+  return std::find(bitmap_pages.begin(), bitmap_pages.end(), page_number) !=
+      bitmap_pages.end();
+}
+
+bool File::isAllocated(const PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  const Descriptor& descriptor = *descriptor_;
+  return page_number != Page::INVALID_NUMBER &&
+      page_number < descriptor.header.num_pages &&
+      testBit(descriptor.used_pages, page_number) &&
+      !isBitmapPage(page_number);
+}
+
+void File::allocateFromBitmap(Page& new_page) {
+  Descriptor& descriptor = *descriptor_;
+  FileHeader header = readHeader();
+  PageId page_number;
+  if (header.num_free_pages > 0) {
+    page_number = findBit(descriptor.used_pages, descriptor.free_hint,
+                          header.num_pages, false);
+    assert(page_number < header.num_pages);
+    --header.num_free_pages;
+  } else {
+    page_number = header.num_pages++;
+    coverPages(header);
+  }
+  setBit(descriptor.used_pages, page_number);
+  descriptor.bitmap_dirty[page_number / PAGES_PER_BITMAP] = true;
+  descriptor.free_hint = page_number + 1;
+
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  writePage(page_number, new_page);
+  writeHeader(header);
+}
+
+void File::deleteFromBitmap(const PageId page_number) {
+  if (!isAllocated(page_number)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  Descriptor& descriptor = *descriptor_;
+  FileHeader header = readHeader();
+  clearBit(descriptor.used_pages, page_number);
+  descriptor.bitmap_dirty[page_number / PAGES_PER_BITMAP] = true;
+  descriptor.free_hint = std::min(descriptor.free_hint, page_number);
+  ++header.num_free_pages;
+
+  Page free_page;
+  free_page.initialize();
+  writePage(page_number, free_page);
+  writeHeader(header);
+}
+
+PageId File::firstUsedPage() const {
+  if (usesBitmaps() || descriptor_->page_version >= BITMAP_VERSION) {
+    return nextUsedPage(Page::INVALID_NUMBER);
+  }
+  return readHeader().first_used_page;
+}
+
+PageId File::nextUsedPage(const PageId page_number) const {
+  if (!usesBitmaps()) {
+    if (descriptor_->page_version >= BITMAP_VERSION) {
+      return scanUsedPage(page_number + 1);
+    }
+    return readPageHeader(page_number).next_page_number;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  const Descriptor& descriptor = *descriptor_;
+  const PageId limit = descriptor.header.num_pages;
+  PageId next = page_number;
+  do {
+    next = findBit(descriptor.used_pages, next + 1, limit, true);
+  } while (next < limit && isBitmapPage(next));
+  return next < limit ? next : Page::INVALID_NUMBER;
+}
+
+PageId File::scanUsedPage(const PageId page_number) const {
+  const PageId limit = readHeader().num_pages;
+  for (PageId next = page_number; next < limit; ++next) {
+    // bitmap pages were written as free pages
+    if (readPageHeader(next).current_page_number != Page::INVALID_NUMBER) {
+      return next;
+    }
+  }
+  return Page::INVALID_NUMBER;
+}
+
+void File::openDirect() {
+  if (descriptor_->direct_fd >= 0 ||
+      descriptor_->first_page_offset % DIRECT_ALIGNMENT != 0) {
+    return;
+  }
+  // file systems without direct I/O refuse the flag; the file stays buffered
+  const int fd = ::open(filename_.c_str(), O_RDWR | O_DIRECT);
+  if (fd >= 0) {
+    descriptor_->direct_fd = fd;
   }
 }
 
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+  if (descriptor_ == NULL) {
+    // closed already
+    return;
+  }
+  if (open_counts_[id_] == 1) {
+    // a destructor has nobody to tell about a failed write
+    try {
+      flushHeader();
+    } catch (const FileIOException&) {
+    }
+  }
+  --open_counts_[id_];
+  descriptor_.reset();
+  latch_.reset();
+  mapping_.reset();
+  if (open_counts_[id_] == 0) {
+    open_descriptors_.erase(id_);
+    open_latches_.erase(id_);
+    open_counts_.erase(id_);
   }
 }
 
@@ -272,33 +774,413 @@ void File::writePage(const PageId page_number, const Page& new_page) {
 }
 
 void File::writePage(const PageId page_number, const PageHeader& header,
-                     const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+                     const Page& new_page, IoEngine* engine) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  Descriptor& descriptor = *descriptor_;
+  if (descriptor.write_buffer == NULL) {
+    void* buffer = NULL;
+    if (::posix_memalign(&buffer, DIRECT_ALIGNMENT,
+                         WRITE_BATCH_PAGES * Page::SIZE) != 0) {
+      throw std::bad_alloc();
+    }
+    descriptor.write_buffer = static_cast<char*>(buffer);
+  }
+  std::map<PageId, std::size_t>::iterator pending =
+      descriptor.pending_writes.insert(std::make_pair(
+          page_number, descriptor.pending_writes.size())).first;
+  char* slot = descriptor.write_buffer + pending->second * Page::SIZE;
+  std::memcpy(slot, &header, sizeof(header));
+  std::memcpy(slot + sizeof(header), new_page.data_, Page::DATA_SIZE);
+  if (hasChecksums()) {
+    const std::uint32_t checksum = pageChecksum(slot);
+    std::memcpy(slot + offsetof(PageHeader, checksum), &checksum,
+                sizeof(checksum));
+  }
+  descriptor.pending_count = descriptor.pending_writes.size();
+  if (descriptor.pending_writes.size() == WRITE_BATCH_PAGES) {
+    writePending(engine);
+  }
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+void File::writePending(IoEngine* engine) {
+  Descriptor& descriptor = *descriptor_;
+  std::map<PageId, std::size_t>::const_iterator next =
+      descriptor.pending_writes.begin();
+  // one request per run; the requests must not move once submitted
+  std::vector<IoRequest> runs;
+  runs.reserve(descriptor.pending_writes.size());
+  while (next != descriptor.pending_writes.end()) {
+    const PageId first_page_number = next->first;
+    runs.push_back(IoRequest());
+    std::vector<struct iovec>& iov = runs.back().buffers;
+    do {
+      struct iovec page;
+      page.iov_base = descriptor.write_buffer + next->second * Page::SIZE;
+      page.iov_len = Page::SIZE;
+      iov.push_back(page);
+      ++next;
+    } while (next != descriptor.pending_writes.end() &&
+             next->first == first_page_number + iov.size() &&
+             iov.size() < IOV_MAX);
+    runs.back().offset = pagePosition(first_page_number);
+  }
 
-  return header;
+  if (engine == NULL) {
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+      writeVector(&runs[r].buffers[0], (int) runs[r].buffers.size(),
+                  runs[r].offset);
+    }
+  } else {
+    // the write buffer is aligned, so direct I/O never needs a bounce here
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+      runs[r].operation = IoRequest::WRITE;
+      runs[r].fd = descriptorFor(&runs[r].buffers[0],
+                                 (int) runs[r].buffers.size(), runs[r].offset);
+      engine->submit(&runs[r]);
+    }
+    int error = -1;
+    for (std::size_t r = 0; r < runs.size(); ++r) {
+      engine->wait(&runs[r]);
+      if (error < 0 && runs[r].result < 0) {
+        error = (int) -runs[r].result;
+      } else if (error < 0 && (std::size_t) runs[r].result < runs[r].length()) {
+        error = 0;
+      }
+    }
+    if (error >= 0) {
+      throw FileIOException(filename_, "write", error);
+    }
+  }
+  descriptor.pending_writes.clear();
+  descriptor.pending_count = 0;
+}
+
+void File::writePendingIn(const PageId first_page_number,
+                          const std::size_t count) const {
+  if (descriptor_->pending_count == 0) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  std::map<PageId, std::size_t>::const_iterator pending =
+      descriptor_->pending_writes.lower_bound(first_page_number);
+  if (pending != descriptor_->pending_writes.end() &&
+      pending->first < first_page_number + count) {
+    // writing the buffer out changes the file, not this object
+    const_cast<File*>(this)->writePending();
+  }
+}
+
+bool File::readPending(const PageId page_number, void* buffer,
+                       const std::size_t length) const {
+  if (descriptor_->pending_count == 0) {
+    return false;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  std::map<PageId, std::size_t>::const_iterator pending =
+      descriptor_->pending_writes.find(page_number);
+  if (pending == descriptor_->pending_writes.end()) {
+    return false;
+  }
+  std::memcpy(buffer, descriptor_->write_buffer + pending->second * Page::SIZE,
+              length);
+  return true;
+}
+
+FileHeader File::readHeader() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return descriptor_->header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  descriptor_->header = header;
+  descriptor_->header_dirty = true;
+}
+
+void File::flushHeader() {
+  writeOut(NULL);
+}
+
+void File::writeOut(IoEngine* engine) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  Descriptor& descriptor = *descriptor_;
+  if (!usesBitmaps()) {
+    // the header never runs ahead of the pages
+    writePending(engine);
+    if (descriptor.header_dirty) {
+      writeAt(&descriptor.header, sizeof(FileHeader), descriptor.header_offset);
+      descriptor.header_dirty = false;
+    }
+    return;
+  }
+
+  // pages and bitmap pages first, so the header block never leads to one not
+  // on disk
+  for (std::size_t i = 1; i < descriptor.bitmap_dirty.size(); ++i) {
+    if (!descriptor.bitmap_dirty[i]) {
+      continue;
+    }
+    Page page;
+    page.initialize();
+    if (i < descriptor.bitmap_pages.size()) {
+      page.set_next_page_number(descriptor.bitmap_pages[i]);
+    }
+    std::memcpy(page.data_, &descriptor.used_pages[i * BITMAP_WORDS],
+                PAGES_PER_BITMAP / 8);
+    writePage(descriptor.bitmap_pages[i - 1], page.header_, page, engine);
+    descriptor.bitmap_dirty[i] = false;
+  }
+  writePending(engine);
+  if (descriptor.header_dirty || descriptor.bitmap_dirty[0]) {
+    const HeaderBlock start = {
+        FORMAT_MAGIC, descriptor.version, descriptor.header,
+        descriptor.bitmap_pages.empty() ? Page::INVALID_NUMBER
+                                        : descriptor.bitmap_pages[0]};
+    AlignedBuffer block(Page::SIZE);
+    std::memset(block.data(), 0, Page::SIZE);
+    std::memcpy(block.data(), &start, sizeof(start));
+    std::memcpy(block.data() + BITMAP_OFFSET, &descriptor.used_pages[0],
+                PAGES_PER_BITMAP / 8);
+    writeAt(block.data(), Page::SIZE, 0 /* offset */);
+    descriptor.header_dirty = false;
+    descriptor.bitmap_dirty[0] = false;
+  }
+}
+
+void File::sync() {
+  syncThrough(NULL);
+}
+
+void File::sync(IoEngine& engine) {
+  syncThrough(&engine);
+}
+
+void File::syncThrough(IoEngine* engine) {
+  FileDurability durability;
+  {
+    std::lock_guard<std::recursive_mutex> guard(*latch_);
+    writeOut(engine);
+    durability = descriptor_->durability;
+  }
+  // writes through either descriptor reach the disk with the file
+  if (durability == FileDurability::DATA_SYNC &&
+      ::fdatasync(descriptor_->fd) != 0) {
+    throw FileIOException(filename_, "sync", errno);
+  }
+}
+
+void File::setDurability(const FileDurability durability) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  descriptor_->durability = durability;
+}
+
+FileDurability File::durability() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return descriptor_->durability;
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (readPending(page_number, &header, sizeof(header))) {
+    return header;
+  }
+  if (isDirect()) {
+    // a whole block, so the page stays out of the page cache
+    AlignedBuffer block(DIRECT_ALIGNMENT);
+    readAt(block.data(), DIRECT_ALIGNMENT, pagePosition(page_number));
+    std::memcpy(&header, block.data(), sizeof(header));
+    return header;
+  }
+  readAt(&header, sizeof(header), pagePosition(page_number));
 
   return header;
 }
 
+void File::readAt(void* buffer, const std::size_t length,
+                  const off_t offset) const {
+  struct iovec iov;
+  iov.iov_base = buffer;
+  iov.iov_len = length;
+  readVector(&iov, 1, offset);
+}
+
+void File::writeAt(const void* buffer, const std::size_t length,
+                   const off_t offset) {
+  struct iovec iov;
+  iov.iov_base = const_cast<void*>(buffer);
+  iov.iov_len = length;
+  writeVector(&iov, 1, offset);
+}
+
+void File::readVector(struct iovec* iov, int count, off_t offset) const {
+  if (needsBounce(iov, count, offset)) {
+    std::size_t length = 0;
+    for (int i = 0; i < count; ++i) {
+      length += iov[i].iov_len;
+    }
+    AlignedBuffer bounce(length);
+    struct iovec whole;
+    whole.iov_base = bounce.data();
+    whole.iov_len = length;
+    readVector(&whole, 1, offset);
+    const char* next = bounce.data();
+    for (int i = 0; i < count; ++i) {
+      std::memcpy(iov[i].iov_base, next, iov[i].iov_len);
+      next += iov[i].iov_len;
+    }
+    return;
+  }
+  const int fd = descriptorFor(iov, count, offset);
+  while (count > 0) {
+    const ssize_t done = ::preadv(fd, iov, count, offset);
+    if (done < 0 && errno == EINTR) {
+      continue;
+    }
+    if (done <= 0) {
+      throw FileIOException(filename_, "read", done < 0 ? errno : 0);
+    }
+    offset += done;
+    advanceVector(iov, count, done);
+  }
+}
+
+void File::writeVector(struct iovec* iov, int count, off_t offset) {
+  if (needsBounce(iov, count, offset)) {
+    std::size_t length = 0;
+    for (int i = 0; i < count; ++i) {
+      length += iov[i].iov_len;
+    }
+    AlignedBuffer bounce(length);
+    char* next = bounce.data();
+    for (int i = 0; i < count; ++i) {
+      std::memcpy(next, iov[i].iov_base, iov[i].iov_len);
+      next += iov[i].iov_len;
+    }
+    struct iovec whole;
+    whole.iov_base = bounce.data();
+    whole.iov_len = length;
+    writeVector(&whole, 1, offset);
+    return;
+  }
+  const int fd = descriptorFor(iov, count, offset);
+  while (count > 0) {
+    const ssize_t done = ::pwritev(fd, iov, count, offset);
+    if (done < 0 && errno == EINTR) {
+      continue;
+    }
+    if (done <= 0) {
+      throw FileIOException(filename_, "write", done < 0 ? errno : 0);
+    }
+    offset += done;
+    advanceVector(iov, count, done);
+  }
+}
+
+int File::descriptorFor(const struct iovec* iov, const int count,
+                        const off_t offset) const {
+  const int direct_fd = descriptor_->direct_fd;
+  if (direct_fd < 0 || offset % DIRECT_ALIGNMENT != 0) {
+    return descriptor_->fd;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (reinterpret_cast<std::uintptr_t>(iov[i].iov_base) % DIRECT_ALIGNMENT != 0 ||
+        iov[i].iov_len % DIRECT_ALIGNMENT != 0) {
+      return descriptor_->fd;
+    }
+  }
+  return direct_fd;
+}
+
+bool File::needsBounce(const struct iovec* iov, const int count,
+                       const off_t offset) const {
+  if (descriptor_->direct_fd < 0 || offset % DIRECT_ALIGNMENT != 0) {
+    return false;
+  }
+  std::size_t length = 0;
+  bool aligned = true;
+  for (int i = 0; i < count; ++i) {
+    length += iov[i].iov_len;
+    if (reinterpret_cast<std::uintptr_t>(iov[i].iov_base) % DIRECT_ALIGNMENT != 0 ||
+        iov[i].iov_len % DIRECT_ALIGNMENT != 0) {
+      aligned = false;
+    }
+  }
+  return !aligned && length % DIRECT_ALIGNMENT == 0;
+}
+
+void File::advanceVector(struct iovec*& iov, int& count, std::size_t done) {
+  // skip the buffers that were transferred in full, then trim the next one
+  while (count > 0 && done >= iov->iov_len) {
+    done -= iov->iov_len;
+    ++iov;
+    --count;
+  }
+  if (count > 0) {
+    iov->iov_base = static_cast<char*>(iov->iov_base) + done;
+    iov->iov_len -= done;
+  }
+}
+
+const Page* File::mappedPage(const PageId page_number) const {
+  assert(mapping_ != NULL);
+  if (page_number == Page::INVALID_NUMBER ||
+      (std::size_t) pagePosition(page_number) + Page::SIZE > mapping_->length) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  writePendingIn(page_number, 1);
+  const Page* page = reinterpret_cast<const Page*>(
+      mapping_->base + pagePosition(page_number));
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void File::adviseMapped(const MappedAccess access) const {
+  assert(mapping_ != NULL);
+  int advice = MADV_NORMAL;
+  if (access == MappedAccess::SEQUENTIAL) {
+    advice = MADV_SEQUENTIAL;
+  } else if (access == MappedAccess::RANDOM) {
+    advice = MADV_RANDOM;
+  }
+  // only a hint; a kernel that ignores it reads the mapping just the same
+  ::madvise(const_cast<char*>(mapping_->base), mapping_->length, advice);
+}
+
+void File::prefetchMapped(const PageId first_page_number,
+                          const PageId count) const {
+  assert(mapping_ != NULL);
+  // madvise() wants a start on a memory page boundary
+  const std::size_t memory_page = ::sysconf(_SC_PAGESIZE);
+  std::size_t start =
+      pagePosition(std::max<PageId>(first_page_number, 1));
+  std::size_t end = std::min<std::size_t>(
+      pagePosition(first_page_number + count), mapping_->length);
+  start -= start % memory_page;
+  if (start < end) {
+    ::madvise(const_cast<char*>(mapping_->base) + start, end - start,
+              MADV_WILLNEED);
+  }
+}
+
+void File::checkWritable() const {
+  // files in an older layout are read-only until they are upgraded
+  if (mapping_ != NULL || !usesBitmaps()) {
+    throw ReadOnlyFileException(filename_);
+  }
+}
+
+File::Mapping::~Mapping() {
+  ::munmap(const_cast<char*>(base), length);
+}
+
+File::Descriptor::~Descriptor() {
+  ::free(write_buffer);
+  if (direct_fd >= 0) {
+    ::close(direct_fd);
+  }
+  ::close(fd);
+}
+
 }
@@ -7,16 +7,25 @@
 
 #pragma once
 
-#include <fstream>
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <vector>
+
+#include <sys/types.h>
 
 #include "page.h"
 
+struct iovec;
+
 namespace badgerdb {
 
 class FileIterator;
+class IoEngine;
+struct IoRequest;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
@@ -28,7 +37,8 @@ struct FileHeader {
   PageId num_pages;
 
   /**
-   * Page number of the first used page in the file.
+   * Page number of the first used page in the file.  Only kept in files
+   * without free-page bitmaps.
    */
   PageId first_used_page;
 
@@ -39,6 +49,7 @@ struct FileHeader {
 
   /**
    * Page number of the first free (allocated but unused) page in the file.
+   * Only kept in files without free-page bitmaps.
    */
   PageId first_free_page;
 
@@ -56,41 +67,202 @@ struct FileHeader {
   }
 };
 
+/**
+ * @brief How a File moves pages to and from disk.
+ */
+enum class FileIoMode {
+  /**
+   * Through the kernel page cache.
+   */
+  BUFFERED,
+
+  /**
+   * Straight between the caller's buffers and the disk (O_DIRECT), leaving
+   * the caching to the buffer manager.
+   */
+  DIRECT
+};
+
+/**
+ * @brief Ways of reading a mapped file the kernel can be told about.
+ */
+enum class MappedAccess {
+  /**
+   * No particular order.
+   */
+  NORMAL,
+
+  /**
+   * Pages in ascending order, read ahead aggressively.
+   */
+  SEQUENTIAL,
+
+  /**
+   * No locality, do not read ahead.
+   */
+  RANDOM
+};
+
+/**
+ * @brief What File::sync() guarantees about the changes made before it.
+ */
+enum class FileDurability {
+  /**
+   * They are handed to the operating system, so they survive the process
+   * crashing but not the machine.
+   */
+  NO_SYNC,
+
+  /**
+   * They are on the disk (fdatasync), so they survive the machine crashing
+   * too.
+   */
+  DATA_SYNC
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a descriptor of an underlying file on disk.  Files
+ * contain fixed-sized pages, and they never deallocate space (though they do
+ * reuse deleted pages if possible).  If multiple File objects refer to the
+ * same underlying file, they will share the descriptor.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking up its id in the open_descriptors_ map) and just returns a file object with
+ * the already open descriptor for the file without actually opening the UNIX file again. 
+ *
+ * All I/O is positional (pread/pwrite and their vectored forms), so page reads
+ * and writes from several threads proceed in parallel.  Updates of the file
+ * header and of the page bitmaps are serialized through a latch shared by all
+ * File objects open on the same file.  Opening and closing files is not
+ * threadsafe.
+ *
+ * The file header is read once when the file is opened and kept in memory,
+ * shared by all File objects open on the file.  Changes to it are written
+ * back by flushHeader() and when the last of those objects is closed.
+ *
+ * Page writes are buffered too: up to WRITE_BATCH_PAGES of them are kept in
+ * memory, again shared by all File objects open on the file, and written out
+ * together, each run of consecutive pages with a single call, when the buffer
+ * fills, before the header is written back, and at sync().  Reads see the
+ * buffered writes.  Only sync() makes the writes durable, as far as the
+ * durability mode of the file asks.
+ *
+ * A File object opened with openMapped() also maps the file into memory, and
+ * hands out pointers to pages in place in the mapping.  Such an object is
+ * read-only.
  *
- * @warning This class is not threadsafe.
+ * Files are laid out for direct I/O: the header fills the first Page::SIZE
+ * block, tagged with FORMAT_MAGIC and FORMAT_VERSION, and page N starts at
+ * N * Page::SIZE.  Files in an older layout, including those written before
+ * the tag existed with the pages straight after a bare header, have to be
+ * converted by upgrade() before they can be opened.
+ *
+ * Tagged files track which pages are in use with a bitmap, kept in memory
+ * while the file is open and written back with the header.  The bits for the
+ * first PAGES_PER_BITMAP pages sit in the header block behind the header; each
+ * further run of pages gets a bitmap page of its own, appended to the file
+ * when the run is reached and chained from the header block.  Allocating a
+ * page takes the lowest free page, or the page past the end of the file, and
+ * costs a single page write, as does deleting one.
+ *
+ * Every page written out is stamped with a CRC-32C of its contents in its
+ * header, and every page read in through readPage(), readPages() or
+ * finishReadPages() is checked against it, so a torn or damaged page shows up
+ * as a CorruptPageException rather than as garbage records.  Pages returned
+ * by mappedPage() are not checked.
  */
 class File {
  public:
+  /**
+   * Alignment of file offsets, buffers and lengths that direct I/O requires.
+   */
+  static const std::size_t DIRECT_ALIGNMENT = 4096;
+
+  /**
+   * First word of the header block of a tagged file.  Read as the page count
+   * of an untagged file it would mean a file of several terabytes.
+   */
+  static const std::uint32_t FORMAT_MAGIC = 0x46424442;  // "BDBF"
+
+  /**
+   * Layout version written to new files, the only one that can be written.
+   * Files in an older layout open read-only until they are upgraded.
+   * Version 1 files link their pages in lists like untagged ones, and their
+   * pages, like those of version 2 files, have headers without a checksum.
+   * Pages before version 4 have slot arrays without bitmap words, and pages
+   * before version 5 have headers without a count of the free space in holes.
+   */
+  static const std::uint32_t FORMAT_VERSION = 5;
+
+  /**
+   * Most page writes buffered before they are written out.
+   */
+  static const std::size_t WRITE_BATCH_PAGES = 64;
+
+  /**
+   * Number of pages whose bits fit in the header block (behind the 64 bytes
+   * kept for the header), and in each bitmap page.
+   */
+  static const PageId PAGES_PER_BITMAP = (Page::SIZE - 64) * 8;
+
   /**
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param mode      How to do page I/O; see open().
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static File create(const std::string& filename);
+  static File create(const std::string& filename,
+                     const FileIoMode mode = FileIoMode::BUFFERED);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same descriptor to read to or write fom
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the descriptor associated with this File object are inserted into the
+	 * open_descriptors_ map.
+   *
+   * With FileIoMode::DIRECT, page transfers with aligned buffers bypass the
+   * kernel page cache, and the rest go through an aligned bounce buffer; the
+   * file header is still cached.  The mode belongs to the open file, so it
+   * applies to every File object open on it, and once direct stays direct
+   * until the file is closed.  If the file system does not support direct
+   * I/O or the file predates the aligned layout, the file stays buffered;
+   * isDirect() tells which mode is in force.
+   *
+   * A file in an older layout opens read-only: its pages are converted to
+   * the current layout as they are read, and writes throw
+   * ReadOnlyFileException until upgrade() has rewritten the file.  A page too
+   * full to convert throws InsufficientSpaceException when it is read.
+   *
+   * @param filename  Name of the file.
+   * @param mode      How to do page I/O.
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the operating system refuses to open
+   *                                  it, or it has a layout version newer
+   *                                  than FORMAT_VERSION.
+   */
+  static File open(const std::string& filename,
+                   const FileIoMode mode = FileIoMode::BUFFERED);
+
+  /**
+   * Opens the file named fileName like open(), and maps it into memory
+   * read-only so mappedPage() can return its pages without copying them.  The
+   * mapping covers the pages the file has when it is opened, and reflects
+   * writes made to them through other File objects.  The File object returned
+   * (and its copies) refuses to allocate, write or delete pages.  Pages are
+   * returned as they are on disk, so a file in an older layout has to be
+   * upgraded first.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileIOException         If the operating system refuses to open
+   *                                  or map it, or it has a layout version
+   *                                  other than FORMAT_VERSION.
    */
-  static File open(const std::string& filename);
+  static File openMapped(const std::string& filename);
 
   /**
    * Deletes an existing file.
@@ -101,6 +273,24 @@ class File {
    */
   static void remove(const std::string& filename);
 
+  /**
+   * Rewrites a file in an older layout into the current one, so it gets
+   * free-page bitmaps, page checksums and can do direct I/O.  Pages keep
+   * their numbers and records their ids, though each page gives up room for
+   * the checksum.  The new file is built next to the old one, under the name
+   * with ".upgrade" appended, and then renamed over it.  Files already in the
+   * current layout are left alone.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileNotFoundException   If the file doesn't exist.
+   * @throws  FileOpenException       If the file is currently open.
+   * @throws  FileIOException         If reading, writing or renaming fails.
+   * @throws  InsufficientSpaceException  If a page is too full to make room
+   *                                      for the checksum; the file is left
+   *                                      as it was.
+   */
+  static void upgrade(const std::string& filename);
+
   /**
    * Returns true if the file exists and is open.
    *
@@ -108,6 +298,12 @@ class File {
    */
   static bool isOpen(const std::string& filename);
 
+  /**
+   * Returns true if this object is open on its file.  Unlike the static
+   * isOpen() it is a field read, cheap enough for the page write path.
+   */
+  bool isOpen() const { return descriptor_ != NULL; }
+
 
   /**
    * Returns true if the file exists and is open.
@@ -145,6 +341,37 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, building it in the given page object
+   * rather than in a new one.
+   *
+   * @param new_page  Page overwritten with the new page.
+   * @throws  ReadOnlyFileException   If this object was opened with
+   *                                  openMapped().
+   */
+  void allocatePage(Page& new_page);
+
+  /**
+   * Allocates a run of new pages with consecutive page numbers at the end of
+   * the file, building them in the given page objects.  The header is
+   * updated once and the pages are written with a single vectored write.
+   * Free pages are left for allocatePage() to reuse.
+   *
+   * @param new_pages     Pages overwritten with the new pages, in page number
+   *                      order.
+   * @param preallocate   Whether to have the file system reserve the space
+   *                      for the run in one piece first.  File systems that
+   *                      cannot are left to allocate it as it is written.
+   * @return  Number of the first page allocated, or Page::INVALID_NUMBER if
+   *          new_pages is empty.
+   * @throws  ReadOnlyFileException   If this object was opened with
+   *                                  openMapped().
+   * @throws  FileIOException         If the space cannot be reserved or the
+   *                                  write fails.
+   */
+  PageId allocatePages(const std::vector<Page*>& new_pages,
+                       const bool preallocate = false);
+
   /**
    * Reads an existing page from the file.
    *
@@ -152,25 +379,184 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  CorruptPageException  If the page fails its checksum.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file into the given page object, reusing
+   * its storage.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page overwritten with the page read.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  CorruptPageException  If the page fails its checksum.
+   */
+  void readPage(const PageId page_number, Page& page) const;
+
+  /**
+   * Reads a run of consecutive existing pages from the file into the given
+   * page objects with a single vectored read.
+   *
+   * @param first_page_number   Number of first page to read.
+   * @param pages               Pages overwritten with the pages read, in page
+   *                            number order.
+   * @throws  InvalidPageException  If any of the pages doesn't exist in the
+   *                                file or is not currently used.
+   * @throws  CorruptPageException  If any of the pages fails its checksum.
+   */
+  void readPages(const PageId first_page_number,
+                 const std::vector<Page*>& pages) const;
+
+  /**
+   * Starts reading a run of consecutive existing pages through an I/O engine,
+   * so a caller with several runs to read can have them all in flight.  The
+   * pages must be left alone until engine.wait() has returned for the request
+   * and finishReadPages() has checked it.
+   *
+   * @param engine              Engine to submit the read to.
+   * @param first_page_number   Number of first page to read.
+   * @param pages               Pages overwritten with the pages read, in page
+   *                            number order.
+   * @param request             Request to submit; must outlive the read.
+   * @throws  InvalidPageException  If the run goes past the end of the file.
+   */
+  void startReadPages(IoEngine& engine, const PageId first_page_number,
+                      const std::vector<Page*>& pages,
+                      IoRequest& request) const;
+
+  /**
+   * Checks the outcome of a read started by startReadPages() once it has
+   * completed.
+   *
+   * @param first_page_number   Number of first page read.
+   * @param pages               Pages read into.
+   * @param request             Completed request.
+   * @throws  FileIOException       If the read failed or hit the end of the
+   *                                file.
+   * @throws  InvalidPageException  If any of the pages is not currently used.
+   * @throws  CorruptPageException  If any of the pages fails its checksum.
+   */
+  void finishReadPages(const PageId first_page_number,
+                       const std::vector<Page*>& pages,
+                       const IoRequest& request) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
+   * The write is buffered; see sync().
    *
    * @see allocatePage()
    * @param new_page  Page to write.
+   * @throws  ReadOnlyFileException   If this object was opened with
+   *                                  openMapped().
    */
   void writePage(const Page& new_page);
 
+  /**
+   * Writes a page into the file like writePage(), but when the write batch
+   * fills up, writes it out through an I/O engine, with every run of
+   * consecutive pages in flight at once.
+   *
+   * @param new_page  Page to write.
+   * @param engine    Engine to write the batch through.
+   * @throws  ReadOnlyFileException   If this object was opened with
+   *                                  openMapped().
+   */
+  void writePage(const Page& new_page, IoEngine& engine);
+
   /**
    * Deletes a page from the file.
    *
    * @param page_number   Number of page to delete.
+   * @throws  ReadOnlyFileException   If this object was opened with
+   *                                  openMapped().
    */
   void deletePage(const PageId page_number);
 
+  /**
+   * Writes out the buffered page writes, then the file header and the
+   * free-page bitmaps if they have changed since they were last written.
+   *
+   * @throws  FileIOException   If a write fails.
+   */
+  void flushHeader();
+
+  /**
+   * Makes the changes made to the file so far durable: writes out the
+   * buffered page writes and the header like flushHeader(), then, in
+   * FileDurability::DATA_SYNC mode, waits for them to reach the disk.
+   *
+   * @throws  FileIOException   If a write or the sync fails.
+   */
+  void sync();
+
+  /**
+   * Makes the changes made to the file so far durable like sync(), but
+   * writes the buffered page writes out through an I/O engine, with every
+   * run of consecutive pages in flight at once.
+   *
+   * @param engine    Engine to write the batch through.
+   * @throws  FileIOException   If a write or the sync fails.
+   */
+  void sync(IoEngine& engine);
+
+  /**
+   * Sets what sync() guarantees.  The mode belongs to the open file, so it
+   * applies to every File object open on it.  New files and files just
+   * opened are in FileDurability::DATA_SYNC mode.
+   *
+   * @param durability  New durability mode.
+   */
+  void setDurability(const FileDurability durability);
+
+  /**
+   * Returns what sync() guarantees.
+   */
+  FileDurability durability() const;
+
+  /**
+   * Returns true if pages of this file are transferred with direct I/O.
+   */
+  bool isDirect() const { return descriptor_->direct_fd >= 0; }
+
+  /**
+   * Returns true if this object was opened with openMapped().
+   */
+  bool isMapped() const { return mapping_ != NULL; }
+
+  /**
+   * Returns an existing page in place in the mapping of a file opened with
+   * openMapped(), after writing out a buffered write of it.  The page stays
+   * valid for as long as this object or a copy of it is open.
+   *
+   * @param page_number   Number of page to return.
+   * @return  The page, in the mapping.
+   * @throws  InvalidPageException  If the page is not in the mapping or is not
+   *                                currently used.
+   */
+  const Page* mappedPage(const PageId page_number) const;
+
+  /**
+   * Tells the kernel how the mapping of a file opened with openMapped() is
+   * about to be read, so it reads ahead as far as suits the pattern.
+   *
+   * @param access  Expected access pattern.
+   */
+  void adviseMapped(const MappedAccess access) const;
+
+  /**
+   * Asks the kernel to start reading a run of pages of the mapping of a file
+   * opened with openMapped() in the background.  Pages past the end of the
+   * mapping are ignored.
+   *
+   * @param first_page_number   Number of first page of the run.
+   * @param count               Number of pages in the run.
+   */
+  void prefetchMapped(const PageId first_page_number,
+                      const PageId count) const;
+
   /**
    * Returns the name of the file this object represents.
    *
@@ -178,6 +564,15 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns the id of the file this object represents.  A file name gets its
+   * id the first time it is opened and keeps it for the life of the process,
+   * so File objects on the same file have the same id even across closes.
+   *
+   * @return Id of file.
+   */
+  FileId id() const { return id_; }
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -201,8 +596,9 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  off_t pagePosition(const PageId page_number) const {
+    return descriptor_->first_page_offset +
+        ((off_t) (page_number - 1) * Page::SIZE);
   }
 
   /**
@@ -214,28 +610,174 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param mode        How to do page I/O.
+   * @param old_layout  Whether to accept a file in an older layout, for
+   *                    upgrade() to read from.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileIoMode mode = FileIoMode::BUFFERED,
+       const bool old_layout = false);
 
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing descriptor.
    *
    * @param create_new  Whether to create a new file.
+   * @param mode        How to do page I/O.
+   * @param old_layout  Whether to accept a file in an older layout.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new,
+                    const FileIoMode mode = FileIoMode::BUFFERED,
+                    const bool old_layout = false);
+
+  /**
+   * Works out the layout of the file just opened on descriptor_ from the tag
+   * of its header block, and loads the header and bitmaps of an existing file.
+   * A new file gets the current layout; its header block is written by
+   * flushHeader().  A file in an older layout, if accepted, only has its
+   * header loaded, and its pages are found by their headers.
+   *
+   * @param create_new  Whether the file is new.
+   * @param old_layout  Whether to accept a file in an older layout.
+   * @throws  FileIOException   If the file has another layout version and
+   *                            that is not accepted.
+   */
+  void readFormat(const bool create_new, const bool old_layout);
+
+  /**
+   * Loads the header and the free-page bitmaps of a file in the current
+   * layout.
+   */
+  void loadBitmaps();
+
+  /**
+   * Returns true if the file tracks its pages with bitmaps rather than lists.
+   */
+  bool usesBitmaps() const { return descriptor_->version >= BITMAP_VERSION; }
+
+  /**
+   * Returns true if the pages of the file carry checksums.
+   */
+  bool hasChecksums() const {
+    return descriptor_->version >= CHECKSUM_VERSION;
+  }
+
+  /**
+   * Throws if a page just read does not match its checksum.  A page never
+   * written reads as zeros, and has no checksum to match.
+   *
+   * @param page_number   Number of the page.
+   * @param page          The page as read.
+   * @throws  CorruptPageException  If the page fails its checksum.
+   */
+  void verifyPage(const PageId page_number, const Page& page) const;
+
+  /**
+   * Moves the contents of a page read from a file in an older layout to where
+   * the current layout has them.  The records stay put: the page header was
+   * shorter, so the slot array moves up to make room for the rest of it, and
+   * where the slot array had no bitmap words, they are put in.  Either way the
+   * free space between the slots and the records shrinks.  Older pages were
+   * always compacted, so they have no holes between their records.
+   *
+   * @param page      Page to convert, in place.
+   * @param version   Layout version of the file the page was read from, 0 if
+   *                  untagged.
+   * @throws  InsufficientSpaceException  If the page has too little free space.
+   */
+  static void convertPage(Page& page, const std::uint32_t version);
+
+  /**
+   * Appends bitmap pages to the file until every page number below
+   * header.num_pages has a bit.  Caller holds the file latch.
+   *
+   * @param header  Header of the file, updated for the pages appended.
+   */
+  void coverPages(FileHeader& header);
+
+  /**
+   * Returns true if the given page is a bitmap page.  Caller holds the file
+   * latch.
+   */
+  bool isBitmapPage(const PageId page_number) const;
+
+  /**
+   * Returns true if the given page is a used page of a file with bitmaps.
+   */
+  bool isAllocated(const PageId page_number) const;
+
+  /**
+   * Allocates a page in a file with bitmaps.  Caller holds the file latch.
+   */
+  void allocateFromBitmap(Page& new_page);
+
+  /**
+   * Deletes a page from a file with bitmaps.  Caller holds the file latch.
+   */
+  void deleteFromBitmap(const PageId page_number);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Returns the number of the first used page of the file, or
+   * Page::INVALID_NUMBER if there is none.
+   */
+  PageId firstUsedPage() const;
+
+  /**
+   * Returns the number of the used page following the given one, or
+   * Page::INVALID_NUMBER if there is none.
+   */
+  PageId nextUsedPage(const PageId page_number) const;
+
+  /**
+   * Returns the number of the first page at or after the given one whose
+   * header says it is used, or Page::INVALID_NUMBER if there is none.  Files
+   * in an older layout with bitmaps are read without them, so this is how
+   * their pages are found.
+   */
+  PageId scanUsedPage(const PageId page_number) const;
+
+  /**
+   * Converts a used page read from a file in an older layout to the current
+   * one, and leaves any other page alone.
+   *
+   * @param page      Page as read.
+   * @throws  InsufficientSpaceException  If the page is too full to convert.
+   */
+  void convertRead(Page& page) const;
+
+  /**
+   * Opens the file a second time for direct I/O, unless that is done already,
+   * the layout is not aligned or the file system refuses.
+   */
+  void openDirect();
+
+  /**
+   * Returns the descriptor to transfer the given buffers at the given offset
+   * through: the direct one if everything is aligned for it, the buffered one
+   * otherwise.
+   */
+  int descriptorFor(const struct iovec* iov, const int count,
+                    const off_t offset) const;
+
+  /**
+   * Returns true if a transfer of the given buffers at the given offset can
+   * only go direct through an aligned bounce buffer: direct I/O is on and the
+   * offset and total length are aligned, but some buffer is not.
+   */
+  bool needsBounce(const struct iovec* iov, const int count,
+                   const off_t offset) const;
+
+  /**
+   * Releases the underlying file descriptor in <descriptor_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -245,19 +787,35 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; reading past the end of the file throws
+   * a FileIOException.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
    * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  CorruptPageException  If the page fails its checksum.
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
   /**
-   * Writes a page into the file at the given page number.  This does not
+   * Reads a page from the file into the given page object, as above.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page overwritten with the page read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @throws  InvalidPageException  If the page is free (unused) and
+   *                                allow_free is false.
+   * @throws  CorruptPageException  If the page fails its checksum.
+   */
+  void readPage(const PageId page_number, Page& page,
+                const bool allow_free) const;
+
+
+  /**
+   * Buffers a write of a page at the given page number, replacing any write
+   * of it already buffered.  This does not
    * update ensure that the number in the header equals the position on disk.
    * No bounds checking is performed.
    *
@@ -267,28 +825,79 @@ class File {
   void writePage(const PageId page_number, const Page& new_page);
 
   /**
-   * Writes a page into the file at the given page number with the given header.
+   * Buffers a write of a page at the given page number with the given header.
    * This does not ensure that the number in the header equals the position on
    * disk.  No bounds checking is performed.
    *
    * @param page_number Number of page whose contents to replace.
    * @param header      Header of page to write.
    * @param new_page    Page to write.
+   * @param engine      Engine to write a full batch through, NULL to write it
+   *                    directly.
    */
   void writePage(const PageId page_number, const PageHeader& header,
-                 const Page& new_page);
+                 const Page& new_page, IoEngine* engine = NULL);
+
+  /**
+   * Checks that a page is allocated and buffers a write of it.
+   *
+   * @param new_page    Page to write.
+   * @param engine      Engine to write a full batch through, NULL to write it
+   *                    directly.
+   */
+  void writeAllocatedPage(const Page& new_page, IoEngine* engine);
+
+  /**
+   * Writes out the buffered page writes, in page number order, each run of
+   * consecutive pages with one call, or, given an engine, as one request
+   * each, all submitted before any is waited for.  Caller holds the file
+   * latch.
+   *
+   * @param engine      Engine to write through, NULL to write directly.
+   * @throws  FileIOException   If a write fails; the writes stay buffered.
+   */
+  void writePending(IoEngine* engine = NULL);
 
   /**
-   * Reads the header for this file from disk.
+   * Does the work of flushHeader(), writing the buffered page writes
+   * through the given engine, if any.
+   */
+  void writeOut(IoEngine* engine);
+
+  /**
+   * Does the work of sync(), writing the buffered page writes through the
+   * given engine, if any.
+   */
+  void syncThrough(IoEngine* engine);
+
+  /**
+   * Writes out the buffered page writes if any of them is for a page in the
+   * given run, so a read of the run from disk sees them.
+   */
+  void writePendingIn(const PageId first_page_number,
+                      const std::size_t count) const;
+
+  /**
+   * Copies the first <length> bytes of the buffered write of the given page,
+   * if there is one.
+   *
+   * @return  True if the page had a buffered write.
+   */
+  bool readPending(const PageId page_number, void* buffer,
+                   const std::size_t length) const;
+
+  /**
+   * Returns the header of this file, from memory.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the header of this file in memory; flushHeader() writes it to
+   * disk.
    *
-   * @param header  File header to write.
+   * @param header  New file header.
    */
   void writeHeader(const FileHeader& header);
 
@@ -301,29 +910,275 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string,
-                   std::shared_ptr<std::fstream> > StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  /**
+   * Reads exactly <length> bytes at the given offset.
+   *
+   * @throws  FileIOException   If the read fails or hits the end of the file.
+   */
+  void readAt(void* buffer, const std::size_t length, const off_t offset) const;
 
   /**
-   * Streams for opened files.
+   * Writes exactly <length> bytes at the given offset.
+   *
+   * @throws  FileIOException   If the write fails.
    */
-  static StreamMap open_streams_;
+  void writeAt(const void* buffer, const std::size_t length,
+               const off_t offset);
+
+  /**
+   * Fills the given buffers, in order, from consecutive bytes starting at the
+   * given offset, retrying after short reads.  The iovec array is consumed.
+   *
+   * @throws  FileIOException   If the read fails or hits the end of the file.
+   */
+  void readVector(struct iovec* iov, int count, off_t offset) const;
+
+  /**
+   * Writes the given buffers, in order, to consecutive bytes starting at the
+   * given offset, retrying after short writes.  The iovec array is consumed.
+   *
+   * @throws  FileIOException   If the write fails.
+   */
+  void writeVector(struct iovec* iov, int count, off_t offset);
+
+  /**
+   * Moves an iovec array past <done> bytes that have been transferred.
+   */
+  static void advanceVector(struct iovec*& iov, int& count, std::size_t done);
+
+  /**
+   * Throws ReadOnlyFileException if this object was opened with openMapped(),
+   * or is on a file in an older layout, opened only for upgrade() to read.
+   */
+  void checkWritable() const;
+
+  /**
+   * @brief Read-only mapping of a file, unmapped when the last File object
+   *        using it lets go of it.
+   */
+  struct Mapping {
+    Mapping(const char* base, const std::size_t length)
+        : base(base), length(length) {}
+    ~Mapping();
+
+    const char* const base;
+    const std::size_t length;
+  };
+
+  /**
+   * @brief Start of the header block of a tagged file.
+   */
+  struct HeaderBlock {
+    std::uint32_t magic;
+    std::uint32_t version;
+    FileHeader header;
+
+    /**
+     * First bitmap page, for the pages after the first PAGES_PER_BITMAP.
+     */
+    PageId first_bitmap_page;
+  };
+
+  /**
+   * Earliest layout version with free-page bitmaps.
+   */
+  static const std::uint32_t BITMAP_VERSION = 2;
+
+  /**
+   * Earliest layout version whose page headers carry a checksum.
+   */
+  static const std::uint32_t CHECKSUM_VERSION = 3;
+
+  /**
+   * Earliest layout version whose pages keep bitmaps of their used slots.
+   */
+  static const std::uint32_t SLOT_BITMAP_VERSION = 4;
+
+  /**
+   * Earliest layout version whose page headers count the free space in holes
+   * between the records.
+   */
+  static const std::uint32_t FRAGMENTATION_VERSION = 5;
+
+  /**
+   * Position of the bits in the header block.  Bitmap pages keep theirs at
+   * the start of the page data.
+   */
+  static const std::size_t BITMAP_OFFSET = Page::SIZE - PAGES_PER_BITMAP / 8;
+
+  /**
+   * Number of words in one bitmap.
+   */
+  static const std::size_t BITMAP_WORDS = PAGES_PER_BITMAP / 64;
+
+  /**
+   * @brief Descriptor of an open file, closed when the last File object
+   *        using it lets go of it.
+   */
+  struct Descriptor {
+    explicit Descriptor(const int fd)
+        : fd(fd),
+          direct_fd(-1),
+          header_offset(0),
+          first_page_offset(sizeof(FileHeader)),
+          version(0),
+          page_version(FORMAT_VERSION),
+          header(),
+          header_dirty(false),
+          free_hint(1),
+          durability(FileDurability::DATA_SYNC),
+          write_buffer(NULL),
+          pending_count(0) {}
+    ~Descriptor();
+
+    /**
+     * Buffered descriptor, used for everything direct I/O cannot take.
+     */
+    const int fd;
+
+    /**
+     * The same file opened with O_DIRECT, or -1.
+     */
+    std::atomic<int> direct_fd;
+
+    /**
+     * Position of the FileHeader in the file.
+     */
+    off_t header_offset;
+
+    /**
+     * Position of page 1 in the file.
+     */
+    off_t first_page_offset;
+
+    /**
+     * Layout version of the file, 0 if it is untagged or in an older layout.
+     */
+    std::uint32_t version;
+
+    /**
+     * Layout version the pages are in, 0 if the file is untagged.  Pages of
+     * files in an older layout are converted from it as they are read.
+     */
+    std::uint32_t page_version;
+
+    /**
+     * The file header.  Protected by the file latch.
+     */
+    FileHeader header;
+
+    /**
+     * True if header has changed since it was last written to the file.
+     */
+    bool header_dirty;
+
+    /**
+     * One bit per page number, set for used pages, the header and bitmap
+     * pages; BITMAP_WORDS words per bitmap.  The rest of the bitmap fields
+     * are protected by the file latch too.
+     */
+    std::vector<std::uint64_t> used_pages;
+
+    /**
+     * Page numbers of the bitmap pages, for the bitmaps after the first one.
+     */
+    std::vector<PageId> bitmap_pages;
+
+    /**
+     * For each bitmap, true if it has changed since it was last written.
+     */
+    std::vector<bool> bitmap_dirty;
+
+    /**
+     * No page below this one is free.
+     */
+    PageId free_hint;
+
+    /**
+     * What sync() guarantees.  Protected by the file latch.
+     */
+    FileDurability durability;
+
+    /**
+     * Buffered page writes, by page number, each with the slot of
+     * write_buffer holding the page.  Protected by the file latch.
+     */
+    std::map<PageId, std::size_t> pending_writes;
+
+    /**
+     * WRITE_BATCH_PAGES slots of Page::SIZE bytes, aligned for direct I/O, or
+     * NULL until the first write.
+     */
+    char* write_buffer;
+
+    /**
+     * Number of buffered page writes, readable without the latch so reads
+     * can tell there are none cheaply.
+     */
+    std::atomic<std::size_t> pending_count;
+  };
+
+  typedef std::map<std::string, FileId> IdMap;
+  typedef std::map<FileId, std::shared_ptr<Descriptor> > DescriptorMap;
+  typedef std::map<FileId, int> CountMap;
+  typedef std::map<FileId,
+                   std::shared_ptr<std::recursive_mutex> > LatchMap;
+
+  /**
+   * Returns the id of the named file, handing out the next one if the name
+   * has none yet.
+   *
+   * @param filename  Name of the file.
+   * @return  Id of file.
+   */
+  static FileId internId(const std::string& filename);
+
+  /**
+   * Ids of every file name opened so far.
+   */
+  static IdMap file_ids_;
+
+  /**
+   * Descriptors of opened files.
+   */
+  static DescriptorMap open_descriptors_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Latches for opened files.
+   */
+  static LatchMap open_latches_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Id of the file this object represents; keys the maps of opened files.
+   */
+  FileId id_;
+
+  /**
+   * Descriptor of underlying filesystem object.
+   */
+  std::shared_ptr<Descriptor> descriptor_;
+
+  /**
+   * Latch serializing read-modify-write updates of the file header and the
+   * page bitmaps.
+   */
+  std::shared_ptr<std::recursive_mutex> latch_;
+
+  /**
+   * Mapping of the file if this object was opened with openMapped(), NULL
+   * otherwise.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<Mapping> mapping_;
 
   friend class FileIterator;
   friend class FileTest;
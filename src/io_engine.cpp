@@ -0,0 +1,398 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// without the kernel header there is no io_uring, only the thread pool
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define BADGERDB_HAVE_IO_URING 1
+#endif
+#endif
+
+namespace badgerdb {
+
+std::size_t IoRequest::length() const {
+  std::size_t total = 0;
+  for (std::size_t i = 0; i < buffers.size(); ++i) {
+    total += buffers[i].iov_len;
+  }
+  return total;
+}
+
+IoEngine* IoEngine::create(const std::uint32_t queueDepth,
+                           const bool allowUring) {
+  const std::uint32_t depth = std::max<std::uint32_t>(1, queueDepth);
+  if (allowUring) {
+    IoEngine* engine = UringIoEngine::tryCreate(depth);
+    if (engine != NULL) {
+      return engine;
+    }
+  }
+  return new ThreadPoolIoEngine(depth);
+}
+
+void IoEngine::wait(IoRequest* request) {
+  std::unique_lock<std::mutex> guard(latch);
+  while (!request->done) {
+    completed.wait(guard);
+  }
+}
+
+void IoEngine::reset(IoRequest* request) {
+  request->result = 0;
+  request->done = false;
+}
+
+bool IoEngine::carryOn(IoRequest* request, const ssize_t result) {
+  if (result < 0) {
+    request->result = result;
+    return false;
+  }
+  request->result += result;
+  std::size_t skip = request->result;
+  if (result == 0 || skip >= request->length()) {
+    // done, or the end of the file
+    return false;
+  }
+  // the rest starts part way into one of the buffers
+  std::size_t first = 0;
+  while (skip >= request->buffers[first].iov_len) {
+    skip -= request->buffers[first].iov_len;
+    ++first;
+  }
+  request->remaining.assign(request->buffers.begin() + first,
+                            request->buffers.end());
+  request->remaining[0].iov_base =
+      static_cast<char*>(request->remaining[0].iov_base) + skip;
+  request->remaining[0].iov_len -= skip;
+  return true;
+}
+
+void IoEngine::complete(IoRequest* request) {
+  std::lock_guard<std::mutex> guard(latch);
+  request->done = true;
+  completed.notify_all();
+}
+
+//----------------------------------------
+// Thread pool
+//----------------------------------------
+
+const std::uint32_t ThreadPoolIoEngine::MAX_WORKERS;
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(const std::uint32_t queueDepth)
+    : depth(queueDepth), inFlight(0), running(true) {
+  const std::uint32_t numWorkers = std::min(queueDepth, MAX_WORKERS);
+  for (std::uint32_t i = 0; i < numWorkers; ++i) {
+    workers.push_back(std::thread(&ThreadPoolIoEngine::worker, this));
+  }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+  {
+    std::lock_guard<std::mutex> guard(queueLatch);
+    running = false;
+  }
+  queueWakeup.notify_all();
+  for (std::size_t i = 0; i < workers.size(); ++i) {
+    workers[i].join();
+  }
+}
+
+void ThreadPoolIoEngine::submit(IoRequest* request) {
+  reset(request);
+  {
+    std::unique_lock<std::mutex> guard(queueLatch);
+    while (inFlight == depth) {
+      roomAvailable.wait(guard);
+    }
+    ++inFlight;
+    queue.push_back(request);
+  }
+  queueWakeup.notify_one();
+}
+
+void ThreadPoolIoEngine::worker() {
+  std::unique_lock<std::mutex> guard(queueLatch);
+  while (true) {
+    // drain what is queued before stopping, so no waiter is left hanging
+    while (running && queue.empty()) {
+      queueWakeup.wait(guard);
+    }
+    if (queue.empty()) {
+      return;
+    }
+    IoRequest* request = queue.front();
+    queue.pop_front();
+    guard.unlock();
+
+    const std::vector<struct iovec>* iov = &request->buffers;
+    while (true) {
+      ssize_t result;
+      const int count = (int) std::min<std::size_t>(iov->size(), IOV_MAX);
+      const off_t offset = request->offset + request->result;
+      do {
+        result = request->operation == IoRequest::READ
+                     ? ::preadv(request->fd, &(*iov)[0], count, offset)
+                     : ::pwritev(request->fd, &(*iov)[0], count, offset);
+      } while (result < 0 && errno == EINTR);
+      if (!carryOn(request, result < 0 ? -errno : result)) {
+        break;
+      }
+      iov = &remainingBuffers(request);
+    }
+    complete(request);
+
+    guard.lock();
+    --inFlight;
+    roomAvailable.notify_one();
+  }
+}
+
+//----------------------------------------
+// io_uring
+//----------------------------------------
+
+#ifndef BADGERDB_HAVE_IO_URING
+
+UringIoEngine* UringIoEngine::tryCreate(const std::uint32_t) {
+  return NULL;
+}
+
+#else
+
+namespace {
+
+int ioUringSetup(const unsigned entries, struct io_uring_params* params) {
+  return (int) ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+int ioUringEnter(const int fd, const unsigned toSubmit,
+                 const unsigned minComplete, const unsigned flags) {
+  return (int) ::syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags,
+                         NULL, 0);
+}
+
+void* mapRing(const int fd, const std::size_t size, const off_t offset) {
+  void* ring = ::mmap(NULL, size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, offset);
+  return ring == MAP_FAILED ? NULL : ring;
+}
+
+}
+
+UringIoEngine* UringIoEngine::tryCreate(const std::uint32_t queueDepth) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = ioUringSetup(queueDepth, &params);
+  if (fd < 0) {
+    return NULL;
+  }
+
+  std::size_t sqRingSize =
+      params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  std::size_t cqRingSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  const std::size_t sqEntriesSize =
+      params.sq_entries * sizeof(struct io_uring_sqe);
+
+  // newer kernels map both rings with one call
+#ifdef IORING_FEAT_SINGLE_MMAP
+  const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#else
+  const bool singleMap = false;
+#endif
+  if (singleMap) {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  void* sqRing = mapRing(fd, sqRingSize, IORING_OFF_SQ_RING);
+  void* cqRing = singleMap ? sqRing
+                           : mapRing(fd, cqRingSize, IORING_OFF_CQ_RING);
+  void* sqEntries = mapRing(fd, sqEntriesSize, IORING_OFF_SQES);
+  if (sqRing == NULL || cqRing == NULL || sqEntries == NULL) {
+    if (sqEntries != NULL) {
+      ::munmap(sqEntries, sqEntriesSize);
+    }
+    if (cqRing != NULL && !singleMap) {
+      ::munmap(cqRing, cqRingSize);
+    }
+    if (sqRing != NULL) {
+      ::munmap(sqRing, sqRingSize);
+    }
+    ::close(fd);
+    return NULL;
+  }
+
+  UringIoEngine* engine = new UringIoEngine();
+  engine->ringFd = fd;
+  engine->depth = params.sq_entries;
+  engine->inFlight = 0;
+  engine->sqRing = sqRing;
+  engine->sqRingSize = sqRingSize;
+  engine->cqRing = cqRing;
+  engine->cqRingSize = cqRingSize;
+  engine->sqEntries = sqEntries;
+  engine->sqEntriesSize = sqEntriesSize;
+
+  char* sq = static_cast<char*>(sqRing);
+  char* cq = static_cast<char*>(cqRing);
+  engine->sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  engine->sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  engine->sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  engine->cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  engine->cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  engine->cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  engine->cqEntries = cq + params.cq_off.cqes;
+
+  engine->reaperThread = std::thread(&UringIoEngine::reaper, engine);
+  return engine;
+}
+
+UringIoEngine::~UringIoEngine() {
+  // a no-op with no request behind it tells the reaper to finish up
+  while (enqueue(IORING_OP_NOP, -1, NULL, 0, 0, 0, false /* replacing */) != 0) {
+    std::this_thread::yield();
+  }
+  reaperThread.join();
+
+  ::munmap(sqEntries, sqEntriesSize);
+  if (cqRing != sqRing) {
+    ::munmap(cqRing, cqRingSize);
+  }
+  ::munmap(sqRing, sqRingSize);
+  ::close(ringFd);
+}
+
+void UringIoEngine::submit(IoRequest* request) {
+  reset(request);
+  const int error = enqueue(request, request->buffers, false /* replacing */);
+  if (error != 0) {
+    request->result = error;
+    complete(request);
+  }
+}
+
+int UringIoEngine::enqueue(IoRequest* request,
+                           const std::vector<struct iovec>& iov,
+                           const bool replacing) {
+  const std::uint32_t count =
+      (std::uint32_t) std::min<std::size_t>(iov.size(), IOV_MAX);
+  return enqueue(
+      request->operation == IoRequest::READ ? IORING_OP_READV : IORING_OP_WRITEV,
+      request->fd, iov.empty() ? NULL : &iov[0], count,
+      request->offset + request->result,
+      reinterpret_cast<std::uintptr_t>(request), replacing);
+}
+
+int UringIoEngine::enqueue(const std::uint8_t opcode, const int fd,
+                           const struct iovec* iov, const std::uint32_t count,
+                           const off_t offset, const std::uint64_t userData,
+                           const bool replacing) {
+  std::unique_lock<std::mutex> guard(submitLatch);
+  while (!replacing && inFlight == depth) {
+    roomAvailable.wait(guard);
+  }
+
+  // this is the only producer, so the tail can be read plainly
+  const unsigned tail = *sqTail;
+  const unsigned index = tail & *sqMask;
+  struct io_uring_sqe* sqe = static_cast<struct io_uring_sqe*>(sqEntries) + index;
+  std::memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<std::uintptr_t>(iov);
+  sqe->len = count;
+  sqe->off = offset;
+  sqe->user_data = userData;
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  while (true) {
+    const int entered = ioUringEnter(ringFd, 1, 0, 0);
+    if (entered == 1) {
+      break;
+    }
+    if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // the kernel has not consumed the entry; take it back
+      const int error = errno;
+      __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+      return -error;
+    }
+    std::this_thread::yield();
+  }
+  if (!replacing) {
+    ++inFlight;
+  }
+  return 0;
+}
+
+void UringIoEngine::reaper() {
+  bool stopping = false;
+  while (true) {
+    {
+      std::lock_guard<std::mutex> guard(submitLatch);
+      if (stopping && inFlight == 0) {
+        return;
+      }
+    }
+
+    unsigned head = *cqHead;
+    const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+      ioUringEnter(ringFd, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    std::uint32_t reaped = 0;
+    for (; head != tail; ++head) {
+      const struct io_uring_cqe* cqe =
+          static_cast<const struct io_uring_cqe*>(cqEntries) + (head & *cqMask);
+      const std::uint64_t userData = cqe->user_data;
+      const std::int32_t result = cqe->res;
+      __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+      if (userData == 0) {
+        stopping = true;
+        ++reaped;
+        continue;
+      }
+      IoRequest* request = reinterpret_cast<IoRequest*>(userData);
+      if (carryOn(request, result)) {
+        // enter the rest in the slot this completion frees, rather than
+        // holding up the other completions behind a blocking call
+        const int error = enqueue(request, remainingBuffers(request),
+                                  true /* replacing */);
+        if (error == 0) {
+          continue;
+        }
+        request->result = error;
+      }
+      complete(request);
+      ++reaped;
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(submitLatch);
+      inFlight -= reaped;
+    }
+    roomAvailable.notify_all();
+  }
+}
+
+#endif
+
+}
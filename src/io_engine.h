@@ -0,0 +1,330 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace badgerdb {
+
+/**
+ * @brief One vectored read or write handed to an IoEngine.
+ *
+ * The caller fills in the operation, descriptor, offset and buffers, and must
+ * keep the request and its buffers alive until IoEngine::wait() has returned
+ * for it.
+ */
+struct IoRequest {
+  /**
+   * Kinds of transfer.
+   */
+  enum Operation { READ, WRITE };
+
+  IoRequest() : operation(READ), fd(-1), offset(0), result(0), done(false) {}
+
+  /**
+   * Total number of bytes the buffers ask for.
+   */
+  std::size_t length() const;
+
+  /**
+   * Whether this request reads or writes.
+   */
+  Operation operation;
+
+  /**
+   * Descriptor to transfer through.
+   */
+  int fd;
+
+  /**
+   * Offset in the file of the first byte transferred.
+   */
+  off_t offset;
+
+  /**
+   * Buffers filled or written, in order, from consecutive bytes of the file.
+   */
+  std::vector<struct iovec> buffers;
+
+  /**
+   * Once complete, the number of bytes transferred, which is less than
+   * length() only if the end of the file was reached, or -errno.  While the
+   * request is in flight, the bytes transferred so far.
+   */
+  ssize_t result;
+
+ private:
+  /**
+   * True once the request has completed.
+   */
+  bool done;
+
+  /**
+   * After a short transfer, the parts of the buffers still to transfer.
+   */
+  std::vector<struct iovec> remaining;
+
+  friend class IoEngine;
+};
+
+/**
+ * @brief Keeps many page reads and writes in flight at once.
+ *
+ * Requests are started with submit() and complete in any order; wait() blocks
+ * until a given one has.  After a short transfer the engine submits the rest
+ * again, so a complete request has either moved every byte, hit the end of
+ * the file or failed.
+ *
+ * BufMgr reads batched misses and read-ahead through it, and the write
+ * batches of its files, which the background writer, flushFile() and
+ * eviction fill, go out through it a request per run of pages.  A single miss
+ * is read with a plain pread: the thread needs the page before it can go on,
+ * and there is nothing to overlap the read with.
+ */
+class IoEngine {
+ public:
+  /**
+   * Creates the best engine this system supports: io_uring if the kernel has
+   * it (and allowUring is set), a pool of worker threads otherwise.
+   *
+   * @param queueDepth  Number of requests that may be in flight at once.
+   * @param allowUring  False to always use the thread pool.
+   */
+  static IoEngine* create(const std::uint32_t queueDepth,
+                          const bool allowUring = true);
+
+  /**
+   * Waits for the requests still in flight and releases the engine.
+   */
+  virtual ~IoEngine() {}
+
+  /**
+   * Starts a request.  Blocks while queueDepth requests are in flight.
+   */
+  virtual void submit(IoRequest* request) = 0;
+
+  /**
+   * Blocks until the given submitted request has completed.
+   */
+  void wait(IoRequest* request);
+
+  /**
+   * Name of the mechanism underneath, for diagnostics.
+   */
+  virtual const char* name() const = 0;
+
+ protected:
+  IoEngine() {}
+
+  /**
+   * Clears the completion state of a request about to be submitted.
+   */
+  static void reset(IoRequest* request);
+
+  /**
+   * Adds the outcome of one transfer for a request to its result.
+   *
+   * @param request   Request transferred for.
+   * @param result    Bytes transferred, or -errno.
+   * @return  True if part of the request is still to be transferred, at
+   *          request->offset + request->result from remainingBuffers().
+   */
+  static bool carryOn(IoRequest* request, const ssize_t result);
+
+  /**
+   * Buffers still to be transferred for a request carryOn() kept going.
+   */
+  static std::vector<struct iovec>& remainingBuffers(IoRequest* request) {
+    return request->remaining;
+  }
+
+  /**
+   * Marks a request as complete with the result it has and wakes its waiter.
+   */
+  void complete(IoRequest* request);
+
+ private:
+  /**
+   * Protects the done flags of requests.
+   */
+  std::mutex latch;
+
+  /**
+   * Signalled whenever a request completes.
+   */
+  std::condition_variable completed;
+};
+
+/**
+ * @brief IoEngine running blocking preadv/pwritev calls on worker threads.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * Starts min(queueDepth, MAX_WORKERS) worker threads, and lets queueDepth
+   * requests be in flight at once.
+   */
+  explicit ThreadPoolIoEngine(const std::uint32_t queueDepth);
+
+  ~ThreadPoolIoEngine();
+
+  void submit(IoRequest* request);
+
+  const char* name() const { return "thread pool"; }
+
+  /**
+   * Most worker threads an engine starts.
+   */
+  static const std::uint32_t MAX_WORKERS = 8;
+
+ private:
+  /**
+   * Body of the worker threads.
+   */
+  void worker();
+
+  std::vector<std::thread> workers;
+
+  /**
+   * Submitted requests no worker has picked up yet.
+   */
+  std::deque<IoRequest*> queue;
+
+  /**
+   * Most requests in flight at once.
+   */
+  std::uint32_t depth;
+
+  /**
+   * Requests submitted that have not completed yet, queued or running.
+   */
+  std::uint32_t inFlight;
+
+  /**
+   * Protects queue, inFlight and running.
+   */
+  std::mutex queueLatch;
+
+  std::condition_variable queueWakeup;
+
+  /**
+   * Signalled when a completion makes room for another request.
+   */
+  std::condition_variable roomAvailable;
+
+  bool running;
+};
+
+/**
+ * @brief IoEngine on a Linux io_uring, driven through the raw system calls.
+ *
+ * Built only where <linux/io_uring.h> is available; elsewhere tryCreate()
+ * always returns NULL and IoEngine::create() falls back to the thread pool.
+ *
+ * Submitters fill in submission queue entries under a latch and enter them
+ * straight away; one reaper thread waits on the completion queue.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring with room for queueDepth requests.
+   *
+   * @return  The engine, or NULL if the kernel does not support io_uring.
+   */
+  static UringIoEngine* tryCreate(const std::uint32_t queueDepth);
+
+  ~UringIoEngine();
+
+  void submit(IoRequest* request);
+
+  const char* name() const { return "io_uring"; }
+
+ private:
+  UringIoEngine() {}
+
+  /**
+   * Places one entry on the submission queue and enters it.
+   *
+   * @param replacing   True if the entry takes the place of one just reaped,
+   *                    so it needs no room of its own; false to wait for room.
+   * @return  0, or -errno if the kernel refused the entry.
+   */
+  int enqueue(const std::uint8_t opcode, const int fd,
+              const struct iovec* iov, const std::uint32_t count,
+              const off_t offset, const std::uint64_t userData,
+              const bool replacing);
+
+  /**
+   * Enters the next transfer of a request, waiting for room unless it
+   * replaces one just reaped.
+   *
+   * @return  0, or -errno if the kernel refused the entry.
+   */
+  int enqueue(IoRequest* request, const std::vector<struct iovec>& iov,
+              const bool replacing);
+
+  /**
+   * Body of the reaper thread.
+   */
+  void reaper();
+
+  /**
+   * Descriptor of the ring.
+   */
+  int ringFd;
+
+  void* sqRing;
+  std::size_t sqRingSize;
+  void* cqRing;
+  std::size_t cqRingSize;
+  void* sqEntries;
+  std::size_t sqEntriesSize;
+
+  /**
+   * Pointers into the mapped rings.
+   */
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  void* cqEntries;
+
+  /**
+   * Number of entries in the submission queue.
+   */
+  std::uint32_t depth;
+
+  /**
+   * Entries submitted whose completions have not been reaped.
+   */
+  std::uint32_t inFlight;
+
+  /**
+   * Protects the submission queue and inFlight.
+   */
+  std::mutex submitLatch;
+
+  /**
+   * Signalled when a completion makes room in the queue.
+   */
+  std::condition_variable roomAvailable;
+
+  std::thread reaperThread;
+};
+
+}
@@ -1,17 +1,32 @@
 #include <iostream>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
 //#include <stdio.h>
+#include <cstddef>
 #include <cstring>
+#include <fstream>
 #include <memory>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
 #include "page.h"
 #include "buffer.h"
+#include "checksum.h"
+#include "io_engine.h"
 #include "file_iterator.h"
 #include "page_iterator.h"
+#include "exceptions/corrupt_page_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/hash_not_found_exception.h"
 #include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/read_only_file_exception.h"
 
 #define PRINT_ERROR(str) \
 { \
@@ -37,6 +52,31 @@ void test4();
 void test5();
 void test6();
 void test7();
+void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
 void testBufMgr();
 
 int main() 
@@ -150,6 +190,31 @@ void testBufMgr()
 	test5();
 	test6();
 	test7();
+	test8();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
 
 
 	//Close files before deleting them
@@ -346,7 +411,1883 @@ void test7()
 	std::cout << "Test 7 passed" << "\n";
 }
 
+void readFile1Pages(unsigned int seed)
+{
+	Page *threadPage;
+	char threadBuf[100];
+	for (int n = 0; n < 2000; n++)
+	{
+		seed = seed * 1103515245 + 12345;
+		PageId pageNo = (seed >> 16) % num + 1;
+		bufMgr->readPage(file1ptr, pageNo, threadPage);
+		sprintf(threadBuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+		RecordId recordId = {pageNo, 1};
+		if(strncmp(threadPage->getRecord(recordId).c_str(), threadBuf, strlen(threadBuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		bufMgr->unPinPage(file1ptr, pageNo, false);
+	}
+}
+
+void test8()
+{
+	//Several threads reading the same file through one buffer manager
+	std::vector<std::thread> readers;
+	for (unsigned int t = 0; t < 4; t++)
+		readers.push_back(std::thread(readFile1Pages, t + 1));
+	for (unsigned int t = 0; t < readers.size(); t++)
+		readers[t].join();
+
+	std::cout << "Test 8 passed" << "\n";
+}
+
+void test9()
+{
+	//A scan must not push a hot set out of the pool under the scan resistant policies
+	const ReplacementPolicy policies[] = {ReplacementPolicy::ARC, ReplacementPolicy::TWO_Q, ReplacementPolicy::LRU_2};
+	for (int p = 0; p < 3; p++)
+	{
+		BufMgr policyMgr(10, policies[p]);
+
+		// reference pages 1-4 over and over while a few other pages pass through
+		for (PageId round = 0; round < 20; round++)
+		{
+			for (PageId hot = 1; hot <= 4; hot++)
+			{
+				policyMgr.readPage(file1ptr, hot, page);
+				policyMgr.unPinPage(file1ptr, hot, false);
+			}
+			policyMgr.readPage(file1ptr, 5 + round, page);
+			policyMgr.unPinPage(file1ptr, 5 + round, false);
+		}
+
+		for (PageId scan = 30; scan <= num; scan++)
+		{
+			policyMgr.readPage(file1ptr, scan, page);
+			policyMgr.unPinPage(file1ptr, scan, false);
+		}
+
+		policyMgr.clearBufStats();
+		for (PageId hot = 1; hot <= 4; hot++)
+		{
+			policyMgr.readPage(file1ptr, hot, page);
+			policyMgr.unPinPage(file1ptr, hot, false);
+		}
+		if (policyMgr.getBufStats().diskreads != 0)
+		{
+			PRINT_ERROR("ERROR :: Hot pages were evicted by a scan.");
+		}
+	}
+
+	std::cout << "Test 9 passed" << "\n";
+}
+void test10()
+{
+	//The background writer cleans dirty frames the clock hand has already passed over once
+	BufMgr writerMgr(10);
+	for (i = 1; i <= 10; i++)
+	{
+		writerMgr.readPage(file1ptr, i, page);
+		writerMgr.unPinPage(file1ptr, i, true);
+	}
+	// clears every refbit and writes back the first five frames synchronously
+	for (i = 11; i <= 15; i++)
+	{
+		writerMgr.readPage(file1ptr, i, page);
+		writerMgr.unPinPage(file1ptr, i, false);
+	}
+	if (writerMgr.getBufStats().diskwrites != 5)
+	{
+		PRINT_ERROR("ERROR :: Evicting five dirty pages should have written five pages.");
+	}
+
+	writerMgr.startBackgroundWriter(10);
+	for (int wait = 0; wait < 500 && writerMgr.getBufStats().diskwrites < 10; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	writerMgr.stopBackgroundWriter();
+	if (writerMgr.getBufStats().diskwrites != 10)
+	{
+		PRINT_ERROR("ERROR :: Background writer did not clean the remaining dirty pages.");
+	}
+
+	// nothing is left for a flush to write
+	writerMgr.flushFile(file1ptr);
+	if (writerMgr.getBufStats().diskwrites != 10)
+	{
+		PRINT_ERROR("ERROR :: Pages cleaned by the background writer were written again.");
+	}
+
+	// a write the writer cannot make leaves the page dirty and the writer running
+	BufMgr failMgr(10, ReplacementPolicy::ARC);
+	PageId lostPageNo;
+	failMgr.allocPage(file1ptr, lostPageNo, page);
+	page->insertRecord("test.1 page deleted behind the pool");
+	failMgr.unPinPage(file1ptr, lostPageNo, true);
+	file1ptr->deletePage(lostPageNo);
+	failMgr.startBackgroundWriter(10);
+	for (int wait = 0; wait < 500 && failMgr.getBufStats().writerfailures == 0; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	failMgr.stopBackgroundWriter();
+	if (failMgr.getBufStats().writerfailures == 0 || failMgr.getBufStats().diskwrites != 0)
+	{
+		PRINT_ERROR("ERROR :: Background writer did not record the failed write.");
+	}
+	try
+	{
+		failMgr.flushFile(file1ptr);
+		PRINT_ERROR("ERROR :: Page whose write-back failed was left clean.");
+	}
+	catch(const InvalidPageException &e)
+	{
+	}
+	try
+	{
+		failMgr.disposePage(file1ptr, lostPageNo);
+	}
+	catch(const InvalidPageException &e)
+	{
+	}
+
+	std::cout << "Test 10 passed" << "\n";
+}
+
+void test11()
+{
+	//Two consecutive reads start a read-ahead window of four pages
+	BufMgr aheadMgr(20);
+	aheadMgr.setReadAhead(16);
+	for (i = 1; i <= 2; i++)
+	{
+		aheadMgr.readPage(file1ptr, i, page);
+		aheadMgr.unPinPage(file1ptr, i, false);
+	}
+	for (int wait = 0; wait < 500 && aheadMgr.getBufStats().diskreads < 6; wait++)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	aheadMgr.setReadAhead(0);
+	if (aheadMgr.getBufStats().diskreads != 6)
+	{
+		PRINT_ERROR("ERROR :: Read-ahead did not read the next four pages.");
+	}
+
+	aheadMgr.clearBufStats();
+	for (i = 3; i <= 6; i++)
+	{
+		aheadMgr.readPage(file1ptr, i, page);
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+		if(strncmp(page->getRecord(RecordId{i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		aheadMgr.unPinPage(file1ptr, i, false);
+	}
+	if (aheadMgr.getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Pages read ahead were read again.");
+	}
+
+	std::cout << "Test 11 passed" << "\n";
+}
+
+void test12()
+{
+	//Bulk scans and loads through a strategy recycle their own ring and leave the rest of the pool alone
+	BufMgr ringMgr(40);
+	for (i = 1; i <= 10; i++)
+	{
+		ringMgr.readPage(file1ptr, i, page);
+		ringMgr.unPinPage(file1ptr, i, false);
+	}
+
+	BufferAccessStrategy scan(AccessStrategyType::BULK_READ, 4);
+	for (i = 11; i <= 60; i++)
+	{
+		ringMgr.readPage(file1ptr, i, page, &scan);
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+		if(strncmp(page->getRecord(RecordId{i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		ringMgr.unPinPage(file1ptr, i, false);
+	}
+
+	BufferAccessStrategy load(AccessStrategyType::BULK_WRITE, 4);
+	PageId loaded[30];
+	for (i = 0; i < 30; i++)
+	{
+		ringMgr.allocPage(file4ptr, loaded[i], page, &load);
+		sprintf((char*)tmpbuf, "test.4 Page %d %7.1f", loaded[i], (float)loaded[i]);
+		page->insertRecord(tmpbuf);
+		ringMgr.unPinPage(file4ptr, loaded[i], true);
+	}
+	// all but the last four loaded pages had to be written out to reuse their frames
+	if (ringMgr.getBufStats().diskwrites != 26)
+	{
+		PRINT_ERROR("ERROR :: Bulk load did not recycle its ring.");
+	}
+
+	ringMgr.clearBufStats();
+	for (i = 1; i <= 10; i++)
+	{
+		ringMgr.readPage(file1ptr, i, page);
+		ringMgr.unPinPage(file1ptr, i, false);
+	}
+	if (ringMgr.getBufStats().diskreads != 0)
+	{
+		PRINT_ERROR("ERROR :: Bulk scan or load evicted pages outside its ring.");
+	}
+
+	for (i = 0; i < 30; i++)
+	{
+		ringMgr.readPage(file4ptr, loaded[i], page, &scan);
+		sprintf((char*)tmpbuf, "test.4 Page %d %7.1f", loaded[i], (float)loaded[i]);
+		if(strncmp(page->getRecord(RecordId{loaded[i], 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		ringMgr.unPinPage(file4ptr, loaded[i], false);
+	}
+
+	std::cout << "Test 12 passed" << "\n";
+}
+
+void test13()
+{
+	//Page handles unpin when they go out of scope, so a three frame pool never runs out
+	BufMgr handleMgr(3);
+	for (i = 1; i <= 20; i++)
+	{
+		PageHandle handle = handleMgr.readPage(file1ptr, i);
+		sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+		if(handle.pageNo() != (PageId)i || strncmp(handle->getRecord(RecordId{i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	// moving a handle moves the pin; only three pages can be held at once
+	std::vector<PageHandle> held;
+	for (i = 1; i <= 3; i++)
+		held.push_back(handleMgr.readPage(file1ptr, i));
+	try
+	{
+		PageHandle extra = handleMgr.readPage(file1ptr, 4);
+		PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+	held[0].release();
+	PageHandle moved = std::move(held[1]);
+	if (held[0].pageNo() != Page::INVALID_NUMBER || held[1].pageNo() != Page::INVALID_NUMBER)
+	{
+		PRINT_ERROR("ERROR :: Released page handle returned a page number.");
+	}
+	held.clear();
+	if (!moved || held.size() != 0)
+	{
+		PRINT_ERROR("ERROR :: Moved page handle lost its pin.");
+	}
+
+	// dirty handles are written back by a flush once they are gone
+	PageId newPageNo;
+	{
+		PageHandle fresh = handleMgr.allocPage(file4ptr, newPageNo);
+		fresh->insertRecord("test.4 handle page");
+		fresh.markDirty();
+	}
+	moved = PageHandle();
+	if (moved || moved.pageNo() != Page::INVALID_NUMBER)
+	{
+		PRINT_ERROR("ERROR :: Empty page handle returned a page number.");
+	}
+	handleMgr.flushFile(file4ptr);
+	if (handleMgr.getBufStats().diskwrites != 1)
+	{
+		PRINT_ERROR("ERROR :: Page handle did not unpin its page dirty.");
+	}
+	handleMgr.flushFile(file1ptr);
+
+	std::cout << "Test 13 passed" << "\n";
+}
+
+void test14()
+{
+	//Batched reads pin every listed page, reading each missing page once
+	BufMgr batchMgr(20);
+	batchMgr.readPage(file1ptr, 4, page);
+	batchMgr.clearBufStats();
+
+	const PageId listed[] = {5, 3, 4, 3, 40, 41, 42, 1};
+	std::vector<PageId> pageNos(listed, listed + 8);
+	std::vector<Page*> pages;
+	batchMgr.readPages(file1ptr, pageNos, pages);
+	for (std::size_t k = 0; k < pageNos.size(); k++)
+	{
+		sprintf((char*)tmpbuf, "test.1 Page %u %7.1f", pageNos[k], (float)pageNos[k]);
+		if(pages[k]->page_number() != pageNos[k] || strncmp(pages[k]->getRecord(RecordId{pageNos[k], 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	if (batchMgr.getBufStats().diskreads != 6 || batchMgr.getBufStats().accesses != 8)
+	{
+		PRINT_ERROR("ERROR :: Batched read did not read each missing page exactly once.");
+	}
+	batchMgr.unPinPages(file1ptr, pageNos, false);
+	batchMgr.unPinPage(file1ptr, 4, false);
+	batchMgr.flushFile(file1ptr);
+
+	//A batch that does not fit leaves nothing pinned behind
+	BufMgr smallMgr(4);
+	std::vector<PageId> tooMany;
+	for (i = 1; i <= 5; i++)
+		tooMany.push_back(i);
+	try
+	{
+		smallMgr.readPages(file1ptr, tooMany, pages);
+		PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const BufferExceededException &e)
+	{
+	}
+	tooMany.pop_back();
+	smallMgr.readPages(file1ptr, tooMany, pages);
+	smallMgr.unPinPages(file1ptr, tooMany, false);
+
+	//A batch with more misses than free frames sweeps past the frames it has
+	//already claimed to evict pages whose reference bits it cleared
+	BufMgr wrapMgr(4);
+	wrapMgr.readPage(file1ptr, 1, page);
+	wrapMgr.unPinPage(file1ptr, 1, false);
+	wrapMgr.readPage(file1ptr, 2, page);
+	wrapMgr.unPinPage(file1ptr, 2, false);
+	std::vector<PageId> wrapping;
+	for (i = 3; i <= 6; i++)
+		wrapping.push_back(i);
+	wrapMgr.readPages(file1ptr, wrapping, pages);
+	for (std::size_t k = 0; k < wrapping.size(); k++)
+	{
+		if (pages[k]->page_number() != wrapping[k])
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+	wrapMgr.unPinPages(file1ptr, wrapping, false);
+
+	std::cout << "Test 14 passed" << "\n";
+}
+
+void test15()
+{
+	//Flushing one file leaves the frames of other files alone
+	BufMgr listMgr(20);
+	for (i = 1; i <= 5; i++)
+	{
+		listMgr.readPage(file1ptr, i, page);
+		listMgr.unPinPage(file1ptr, i, true);
+	}
+	listMgr.readPage(file2ptr, 1, page2);
+	listMgr.flushFile(file1ptr);
+	if (listMgr.getBufStats().diskwrites != 5)
+	{
+		PRINT_ERROR("ERROR :: Flush did not write the dirty pages of the file.");
+	}
+
+	//Pages are found through any File object for the same file
+	for (i = 1; i <= 5; i++)
+	{
+		listMgr.readPage(file1ptr, i, page);
+		listMgr.unPinPage(file1ptr, i, true);
+	}
+	{
+		File sameFile = File::open(file1ptr->filename());
+		listMgr.flushFile(&sameFile);
+	}
+	if (listMgr.getBufStats().diskwrites != 10)
+	{
+		PRINT_ERROR("ERROR :: Flush through another File object missed pages of the file.");
+	}
+	listMgr.clearBufStats();
+	listMgr.readPage(file1ptr, 1, page);
+	listMgr.unPinPage(file1ptr, 1, false);
+	if (listMgr.getBufStats().diskreads != 1)
+	{
+		PRINT_ERROR("ERROR :: Flushed pages were left in the buffer pool.");
+	}
+
+	listMgr.unPinPage(file2ptr, 1, false);
+	std::cout << "Test 15 passed" << "\n";
+}
+
+void test16()
+{
+	//Both I/O engines keep several runs of pages in flight
+	for (int useUring = 0; useUring < 2; useUring++)
+	{
+		std::unique_ptr<IoEngine> engine(IoEngine::create(4, useUring == 1));
+		std::vector<Page> buffers(6);
+		std::vector<Page*> lowRun, highRun;
+		for (i = 0; i < 3; i++)
+		{
+			lowRun.push_back(&buffers[i]);
+			highRun.push_back(&buffers[i + 3]);
+		}
+		IoRequest lowRequest, highRequest;
+		file1ptr->startReadPages(*engine, 1, lowRun, lowRequest);
+		file1ptr->startReadPages(*engine, 10, highRun, highRequest);
+		engine->wait(&highRequest);
+		engine->wait(&lowRequest);
+		file1ptr->finishReadPages(1, lowRun, lowRequest);
+		file1ptr->finishReadPages(10, highRun, highRequest);
+		for (i = 0; i < 6; i++)
+		{
+			const PageId pageNo = i < 3 ? i + 1 : i + 7;
+			sprintf((char*)tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+			if(buffers[i].page_number() != pageNo || strncmp(buffers[i].getRecord(RecordId{pageNo, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		// a read running past the end of the file comes back short, and the rest is
+		// submitted again until it hits the end
+		const int fd = ::open(file1ptr->filename().c_str(), O_RDONLY);
+		const off_t size = ::lseek(fd, 0, SEEK_END);
+		IoRequest tailRequest;
+		tailRequest.fd = fd;
+		tailRequest.offset = size - Page::SIZE - 100;
+		tailRequest.buffers.resize(2);
+		tailRequest.buffers[0].iov_base = &buffers[0];
+		tailRequest.buffers[0].iov_len = Page::SIZE;
+		tailRequest.buffers[1].iov_base = &buffers[1];
+		tailRequest.buffers[1].iov_len = Page::SIZE;
+		engine->submit(&tailRequest);
+		engine->wait(&tailRequest);
+		::close(fd);
+		if (tailRequest.result != (ssize_t) Page::SIZE + 100)
+		{
+			PRINT_ERROR("ERROR :: Read running past the end of the file did not stop there.");
+		}
+	}
+
+	//Write batches go out through either engine, a request per run of pages
+	for (int useUring = 0; useUring < 2; useUring++)
+	{
+		std::unique_ptr<IoEngine> engine(IoEngine::create(4, useUring == 1));
+		const PageId written[] = {3, 4, 9};
+		for (i = 0; i < 3; i++)
+		{
+			Page changed = file1ptr->readPage(written[i]);
+			sprintf((char*)tmpbuf, "test.1 Page %u written through engine %d", written[i], useUring);
+			changed.updateRecord(RecordId{written[i], 1}, tmpbuf);
+			file1ptr->writePage(changed, *engine);
+		}
+		file1ptr->sync(*engine);
+		for (i = 0; i < 3; i++)
+		{
+			sprintf((char*)tmpbuf, "test.1 Page %u written through engine %d", written[i], useUring);
+			if (file1ptr->readPage(written[i]).getRecord(RecordId{written[i], 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page written through the engine did not reach the file.");
+			}
+		}
+	}
+	for (i = 0; i < 3; i++)
+	{
+		const PageId pageNo = i < 2 ? i + 3 : 9;
+		Page restored = file1ptr->readPage(pageNo);
+		sprintf((char*)tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+		restored.updateRecord(RecordId{pageNo, 1}, tmpbuf);
+		file1ptr->writePage(restored);
+	}
+	file1ptr->sync();
+
+	//Submitting more requests than the engine has room for waits for room instead of failing
+	{
+		std::unique_ptr<IoEngine> engine(IoEngine::create(1, false));
+		std::vector<Page> buffers(5);
+		std::vector<std::vector<Page*> > runs(5);
+		std::vector<IoRequest> requests(5);
+		for (i = 0; i < 5; i++)
+		{
+			runs[i].push_back(&buffers[i]);
+			file1ptr->startReadPages(*engine, i + 1, runs[i], requests[i]);
+		}
+		for (i = 0; i < 5; i++)
+		{
+			engine->wait(&requests[i]);
+			file1ptr->finishReadPages(i + 1, runs[i], requests[i]);
+			if (buffers[i].page_number() != (PageId) i + 1)
+			{
+				PRINT_ERROR("ERROR :: Request submitted to a full engine read the wrong page.");
+			}
+		}
+	}
+
+	//A batch with a run past the end of the file leaves nothing pinned behind
+	BufMgr asyncMgr(20);
+	const PageId listed[] = {2, 3, 100000, 7, 8};
+	std::vector<PageId> pageNos(listed, listed + 5);
+	std::vector<Page*> pages;
+	try
+	{
+		asyncMgr.readPages(file1ptr, pageNos, pages);
+		PRINT_ERROR("ERROR :: Page is past the end of the file. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const InvalidPageException &e)
+	{
+	}
+	asyncMgr.flushFile(file1ptr);
+
+	std::cout << "Test 16 passed" << "\n";
+}
+
+void test17()
+{
+	//A mapped file hands out its pages in place
+	{
+		File mapped = File::openMapped(file1ptr->filename());
+		mapped.adviseMapped(MappedAccess::SEQUENTIAL);
+		mapped.prefetchMapped(1, 10);
+		for (i = 1; i <= 10; i++)
+		{
+			const Page* mappedPage = mapped.mappedPage(i);
+			sprintf((char*)tmpbuf, "test.1 Page %d %7.1f", i, (float)i);
+			if(mappedPage->page_number() != (PageId)i || strncmp(mappedPage->getRecord(RecordId{(PageId)i, 1}).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+
+		//Writes through other File objects show up in the mapping
+		Page changed = file1ptr->readPage(2);
+		changed.insertRecord("test.1 mapped");
+		file1ptr->writePage(changed);
+		if (mapped.mappedPage(2)->getRecord(RecordId{2, 2}) != "test.1 mapped")
+		{
+			PRINT_ERROR("ERROR :: Mapping did not reflect a write to the file.");
+		}
+
+		try
+		{
+			mapped.mappedPage(100000);
+			PRINT_ERROR("ERROR :: Page is past the end of the mapping. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+
+		//The mapped object itself is read-only
+		try
+		{
+			mapped.writePage(changed);
+			PRINT_ERROR("ERROR :: File is mapped read-only. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const ReadOnlyFileException &e)
+		{
+		}
+	}
+
+	std::cout << "Test 17 passed" << "\n";
+}
+
+//Returns the page bytes with a page header of headerSize bytes cut back to
+//end where the given field starts, as in layouts before that field: the
+//records stay put, and the slot array moves down
+std::string cutHeader(const std::string& bytes, std::size_t headerSize, std::size_t field, bool groupedSlots)
+{
+	const std::size_t grown = headerSize - field;
+	PageHeader header;
+	memcpy(&header, bytes.data(), field);
+	std::string cut = bytes.substr(0, field) +
+		bytes.substr(headerSize, header.free_space_lower_bound) +
+		std::string(grown, '\0') +
+		bytes.substr(headerSize + header.free_space_lower_bound);
+	header.free_space_upper_bound += grown;
+	memcpy(&cut[0], &header, field);
+	for (SlotId slot = 0; slot < header.num_slots; slot++)
+	{
+		//each group of 64 slots follows a word of bits
+		const std::size_t groupWords = groupedSlots ? slot / 64 + 1 : 0;
+		PageSlot pageSlot;
+		char* at = &cut[field + groupWords * sizeof(std::uint64_t) + slot * sizeof(PageSlot)];
+		memcpy(&pageSlot, at, sizeof(pageSlot));
+		if (pageSlot.used)
+			pageSlot.item_offset += grown;
+		memcpy(at, &pageSlot, sizeof(pageSlot));
+	}
+	return cut;
+}
+
+//Returns the page laid out as it was before page headers counted the free
+//space in holes
+std::string unfragmentedPage(const Page& current)
+{
+	return cutHeader(std::string((const char*)&current, Page::SIZE), sizeof(PageHeader),
+		offsetof(PageHeader, fragmented_free_space), true);
+}
+
+//Returns the page laid out as it was before slot bitmaps too, with the slots
+//one after another
+std::string ungroupedPage(const Page& current)
+{
+	const std::size_t headerSize = offsetof(PageHeader, fragmented_free_space);
+	const std::string bytes = unfragmentedPage(current);
+	PageHeader header;
+	memcpy(&header, bytes.data(), headerSize);
+	std::string slots;
+	for (SlotId slot = 0; slot < header.num_slots; slot++)
+	{
+		const std::size_t at = headerSize + (slot / 64 + 1) * sizeof(std::uint64_t) + slot * sizeof(PageSlot);
+		slots += bytes.substr(at, sizeof(PageSlot));
+	}
+	header.free_space_lower_bound = slots.size();
+	std::string ungrouped = std::string((const char*)&header, headerSize) + slots;
+	ungrouped += std::string(headerSize + header.free_space_upper_bound - ungrouped.size(), '\0');
+	return ungrouped + bytes.substr(ungrouped.size());
+}
+
+//Returns the page laid out as it was before page checksums too, with a page
+//header that ends where the checksum field starts
+std::string legacyPage(const Page& current)
+{
+	return cutHeader(ungroupedPage(current), offsetof(PageHeader, fragmented_free_space),
+		offsetof(PageHeader, checksum), false);
+}
+
+void test18()
+{
+	const std::string filename6 = "test.6";
+	const std::string filename7 = "test.7";
+	try
+	{
+		File::remove(filename6);
+		File::remove(filename7);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//Pages go through direct I/O both from buffer frames and from unaligned pages
+	PageId directPid[30];
+	RecordId directRid[30];
+	{
+		File directFile = File::create(filename6, FileIoMode::DIRECT);
+		BufMgr directMgr(10);
+		for (i = 0; i < 30; i++)
+		{
+			directMgr.allocPage(&directFile, directPid[i], page);
+			sprintf((char*)tmpbuf, "test.6 Page %u %7.1f", directPid[i], (float)directPid[i]);
+			directRid[i] = page->insertRecord(tmpbuf);
+			directMgr.unPinPage(&directFile, directPid[i], true);
+		}
+		directMgr.flushFile(&directFile);
+
+		for (i = 0; i < 30; i++)
+		{
+			directMgr.readPage(&directFile, directPid[i], page);
+			Page copy = directFile.readPage(directPid[i]);
+			sprintf((char*)tmpbuf, "test.6 Page %u %7.1f", directPid[i], (float)directPid[i]);
+			if(strncmp(page->getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0 ||
+			   strncmp(copy.getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			directMgr.unPinPage(&directFile, directPid[i], false);
+		}
+	}
+
+	//A file in the old layout, without the tag, opens read-only until it is upgraded
+	{
+		std::ifstream tagged(filename6.c_str(), std::ios::binary);
+		std::string bytes((std::istreambuf_iterator<char>(tagged)), std::istreambuf_iterator<char>());
+		std::ofstream untagged(filename7.c_str(), std::ios::binary);
+		untagged.write(bytes.data() + 2 * sizeof(std::uint32_t), sizeof(FileHeader));
+		for (std::size_t offset = Page::SIZE; offset < bytes.size(); offset += Page::SIZE)
+		{
+			Page current;
+			memcpy((char*)&current, bytes.data() + offset, Page::SIZE);
+			untagged.write(legacyPage(current).data(), Page::SIZE);
+		}
+	}
+	{
+		File oldFile = File::open(filename7);
+		BufMgr oldMgr(4);
+		for (i = 0; i < 30; i++)
+		{
+			Page copy = oldFile.readPage(directPid[i]);
+			oldMgr.readPage(&oldFile, directPid[i], page);
+			sprintf((char*)tmpbuf, "test.6 Page %u %7.1f", directPid[i], (float)directPid[i]);
+			if(strncmp(copy.getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0 ||
+			   strncmp(page->getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+			oldMgr.unPinPage(&oldFile, directPid[i], false);
+		}
+		oldMgr.flushFile(&oldFile);
+		try
+		{
+			oldFile.writePage(oldFile.readPage(directPid[0]));
+			PRINT_ERROR("ERROR :: Page written to a file in the old layout. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const ReadOnlyFileException &e)
+		{
+		}
+	}
+	try
+	{
+		File::openMapped(filename7);
+		PRINT_ERROR("ERROR :: File in the old layout mapped. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const FileIOException &e)
+	{
+	}
+	File::upgrade(filename7);
+	{
+		File oldFile = File::open(filename7, FileIoMode::DIRECT);
+		for (i = 0; i < 30; i++)
+		{
+			Page copy = oldFile.readPage(directPid[i]);
+			sprintf((char*)tmpbuf, "test.6 Page %u %7.1f", directPid[i], (float)directPid[i]);
+			if(strncmp(copy.getRecord(directRid[i]).c_str(), tmpbuf, strlen(tmpbuf)) != 0)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	File::remove(filename6);
+	File::remove(filename7);
+	std::cout << "Test 18 passed" << "\n";
+}
+
+void test19()
+{
+	const std::string filename8 = "test.8";
+	try
+	{
+		File::remove(filename8);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//Every File object open on the file shares one header, kept in memory
+	PageId headerPid;
+	{
+		File first = File::create(filename8);
+		File second = File::open(filename8);
+		Page newPage = first.allocatePage();
+		headerPid = newPage.page_number();
+		newPage.insertRecord("test.8 header");
+		first.writePage(newPage);
+
+		int pages = 0;
+		for (FileIterator iter = second.begin(); iter != second.end(); ++iter)
+			pages++;
+		if (pages != 1)
+		{
+			PRINT_ERROR("ERROR :: Header change was not seen through another File object.");
+		}
+
+		//...and written back when asked to
+		FileHeader onDisk;
+		std::ifstream raw(filename8.c_str(), std::ios::binary);
+		raw.seekg(2 * sizeof(std::uint32_t));
+		raw.read((char*)&onDisk, sizeof(onDisk));
+		if (onDisk.num_pages != 1)
+		{
+			PRINT_ERROR("ERROR :: Header was written on every change.");
+		}
+		second.flushHeader();
+		raw.seekg(2 * sizeof(std::uint32_t));
+		raw.read((char*)&onDisk, sizeof(onDisk));
+		if (onDisk.num_pages != 2)
+		{
+			PRINT_ERROR("ERROR :: Header was not written back.");
+		}
+	}
+
+	//...or when the last File object closes
+	{
+		File first = File::open(filename8);
+		first.allocatePage();
+	}
+	{
+		File reopened = File::open(filename8);
+		if (reopened.readPage(headerPid).getRecord(RecordId{headerPid, 1}) != "test.8 header" ||
+		    reopened.readPage(headerPid + 1).page_number() != headerPid + 1)
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	File::remove(filename8);
+	std::cout << "Test 19 passed" << "\n";
+}
+
+void test20()
+{
+	const std::string filename9 = "test.9";
+	const std::string filename10 = "test.10";
+	try
+	{
+		File::remove(filename9);
+		File::remove(filename10);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//Deleted pages are reused lowest first, and iteration skips them
+	{
+		File bitmapFile = File::create(filename9);
+		for (i = 0; i < 6; i++)
+			bitmapFile.allocatePage();
+		bitmapFile.deletePage(4);
+		bitmapFile.deletePage(2);
+		try
+		{
+			bitmapFile.deletePage(2);
+			PRINT_ERROR("ERROR :: Page deleted twice. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+		try
+		{
+			Page deleted;
+			bitmapFile.writePage(deleted);
+			PRINT_ERROR("ERROR :: Free page written. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const InvalidPageException &e)
+		{
+		}
+
+		PageId expected[] = {1, 3, 5, 6};
+		i = 0;
+		for (FileIterator iter = bitmapFile.begin(); iter != bitmapFile.end(); ++iter)
+		{
+			if (i >= 4 || (*iter).page_number() != expected[i])
+			{
+				PRINT_ERROR("ERROR :: Iteration did not skip the free pages.");
+			}
+			i++;
+		}
+		if (i != 4 || bitmapFile.allocatePage().page_number() != 2 ||
+		    bitmapFile.allocatePage().page_number() != 4 ||
+		    bitmapFile.allocatePage().page_number() != 7)
+		{
+			PRINT_ERROR("ERROR :: Free pages were not reused lowest first.");
+		}
+	}
+	File::remove(filename9);
+
+	//Files linking their pages in lists are converted to bitmaps by upgrade():
+	//used pages 1 and 66000, so the second bitmap is needed, and the rest free
+	const PageId numPages = 70000;
+	const PageId usedPid[2] = {1, 66000};
+	for (int tagged = 1; tagged >= 0; tagged--)
+	{
+		const std::string& name = tagged ? filename9 : filename10;
+		const std::streamoff firstPage = tagged ? Page::SIZE : sizeof(FileHeader);
+		{
+			std::ofstream legacy(name.c_str(), std::ios::binary);
+			if (tagged)
+			{
+				const std::uint32_t tag[2] = {File::FORMAT_MAGIC, 1};
+				legacy.write((const char*)tag, sizeof(tag));
+			}
+			const FileHeader header = {numPages, usedPid[0], numPages - 3, 2};
+			legacy.write((const char*)&header, sizeof(header));
+			for (int j = 0; j < 2; j++)
+			{
+				Page usedPage;
+				sprintf((char*)tmpbuf, "test.9 Page %u", usedPid[j]);
+				usedPage.insertRecord(tmpbuf);
+				PageHeader pageHeader;
+				memcpy(&pageHeader, &usedPage, sizeof(pageHeader));
+				pageHeader.current_page_number = usedPid[j];
+				pageHeader.next_page_number = j == 0 ? usedPid[1] : Page::INVALID_NUMBER;
+				memcpy((char*)&usedPage, &pageHeader, sizeof(pageHeader));
+				legacy.seekp(firstPage + (std::streamoff)(usedPid[j] - 1) * Page::SIZE);
+				legacy.write(legacyPage(usedPage).data(), Page::SIZE);
+			}
+			//the free pages are left as holes, which read as cleared pages
+			legacy.seekp(firstPage + (std::streamoff)(numPages - 1) * Page::SIZE - 1);
+			legacy.put(0);
+		}
+		{
+			//read-only, going by the lists
+			File legacyFile = File::open(name);
+			std::vector<PageId> pids;
+			for (FileIterator iter = legacyFile.begin(); iter != legacyFile.end(); ++iter)
+				pids.push_back((*iter).page_number());
+			if (pids != std::vector<PageId>(usedPid, usedPid + 2))
+			{
+				PRINT_ERROR("ERROR :: Used pages of a file in the old layout were not found.");
+			}
+			try
+			{
+				legacyFile.allocatePage();
+				PRINT_ERROR("ERROR :: Page allocated in a file in the old layout. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const ReadOnlyFileException &e)
+			{
+			}
+		}
+		File::upgrade(name);
+
+		for (int reopen = 0; reopen < 2; reopen++)
+		{
+			File converted = File::open(name);
+			std::vector<PageId> pids;
+			for (FileIterator iter = converted.begin(); iter != converted.end(); ++iter)
+			{
+				Page usedPage = *iter;
+				pids.push_back(usedPage.page_number());
+				if (usedPage.page_number() == 2)
+					continue;
+				sprintf((char*)tmpbuf, "test.9 Page %u", usedPage.page_number());
+				if (usedPage.getRecord(RecordId{usedPage.page_number(), 1}) != tmpbuf)
+				{
+					PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+				}
+			}
+			//page 2 is allocated before reopening
+			std::vector<PageId> expected(usedPid, usedPid + 2);
+			if (reopen == 1)
+				expected.insert(expected.begin() + 1, 2);
+			if (pids != expected)
+			{
+				PRINT_ERROR("ERROR :: Used pages were lost in the conversion.");
+			}
+			try
+			{
+				//the bitmap for the pages past the first bitmap's
+				converted.readPage(numPages);
+				PRINT_ERROR("ERROR :: Bitmap page read as a used page. Exception should have been thrown before execution reaches this point.");
+			}
+			catch(const InvalidPageException &e)
+			{
+			}
+			if (reopen == 0 && converted.allocatePage().page_number() != 2)
+			{
+				PRINT_ERROR("ERROR :: Free pages were lost in the conversion.");
+			}
+		}
+	}
+
+	File::remove(filename9);
+	File::remove(filename10);
+	std::cout << "Test 20 passed" << "\n";
+}
+
+void test21()
+{
+	const std::string filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//A run of pages comes back pinned, with consecutive page numbers
+	{
+		File extentFile = File::create(filename9);
+		BufMgr extentMgr(20);
+		PageId firstPid;
+		std::vector<Page*> pages;
+		for (int preallocate = 0; preallocate < 2; preallocate++)
+		{
+			extentMgr.allocPages(&extentFile, 8, firstPid, pages, preallocate == 1);
+			if (firstPid != 1 + 8 * (PageId)preallocate || pages.size() != 8)
+			{
+				PRINT_ERROR("ERROR :: Pages were not allocated in one run.");
+			}
+			std::vector<PageId> pids;
+			for (i = 0; i < 8; i++)
+			{
+				if (pages[i]->page_number() != firstPid + i)
+				{
+					PRINT_ERROR("ERROR :: Pages were not allocated in one run.");
+				}
+				sprintf((char*)tmpbuf, "test.9 Page %u", firstPid + i);
+				pages[i]->insertRecord(tmpbuf);
+				pids.push_back(firstPid + i);
+			}
+			extentMgr.unPinPages(&extentFile, pids, true);
+		}
+		try
+		{
+			extentMgr.unPinPage(&extentFile, firstPid, false);
+			PRINT_ERROR("ERROR :: Page is already unpinned. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const PageNotPinnedException &e)
+		{
+		}
+
+		//a run longer than the free frames sweeps past the frames it has already
+		//claimed to evict pages whose reference bits it cleared
+		extentMgr.allocPages(&extentFile, 8, firstPid, pages);
+		std::vector<PageId> wrapPids;
+		for (i = 0; i < 8; i++)
+		{
+			if (firstPid != 17 || pages[i]->page_number() != firstPid + i)
+			{
+				PRINT_ERROR("ERROR :: Pages were not allocated in one run.");
+			}
+			sprintf((char*)tmpbuf, "test.9 Page %u", firstPid + i);
+			pages[i]->insertRecord(tmpbuf);
+			wrapPids.push_back(firstPid + i);
+		}
+		extentMgr.unPinPages(&extentFile, wrapPids, true);
+
+		//a run that does not fit in the pool leaves the file alone
+		try
+		{
+			extentMgr.allocPages(&extentFile, 21, firstPid, pages);
+			PRINT_ERROR("ERROR :: No more frames left for allocation. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const BufferExceededException &e)
+		{
+		}
+		extentMgr.flushFile(&extentFile);
+		if (extentFile.allocatePage().page_number() != 25)
+		{
+			PRINT_ERROR("ERROR :: Failed run allocated pages.");
+		}
+		for (i = 1; i <= 24; i++)
+		{
+			sprintf((char*)tmpbuf, "test.9 Page %u", i);
+			if (extentFile.readPage(i).getRecord(RecordId{i, 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+			}
+		}
+	}
+
+	File::remove(filename9);
+	std::cout << "Test 21 passed" << "\n";
+}
+
+void test22()
+{
+	const std::string filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//Page writes stay in memory until sync(), but reads see them
+	{
+		File syncFile = File::create(filename9);
+		if (syncFile.durability() != FileDurability::DATA_SYNC)
+		{
+			PRINT_ERROR("ERROR :: Files should start out synced to disk.");
+		}
+		syncFile.setDurability(FileDurability::NO_SYNC);
+		Page run[3];
+		std::vector<Page*> pages;
+		for (i = 0; i < 3; i++)
+			pages.push_back(&run[i]);
+		syncFile.allocatePages(pages);
+		syncFile.sync();
+		run[1].insertRecord("test.9 buffered");
+		syncFile.writePage(run[1]);
+
+		std::ifstream raw(filename9.c_str(), std::ios::binary);
+		Page onDisk;
+		raw.seekg(2 * Page::SIZE);
+		raw.read((char*)&onDisk, Page::SIZE);
+		if (onDisk.getFreeSpace() != run[0].getFreeSpace())
+		{
+			PRINT_ERROR("ERROR :: Page write was not buffered.");
+		}
+		if (syncFile.readPage(2).getRecord(RecordId{2, 1}) != "test.9 buffered")
+		{
+			PRINT_ERROR("ERROR :: Buffered page write was not seen by a read.");
+		}
+
+		syncFile.setDurability(FileDurability::DATA_SYNC);
+		syncFile.sync();
+		raw.seekg(2 * Page::SIZE);
+		raw.read((char*)&onDisk, Page::SIZE);
+		if (onDisk.getRecord(RecordId{2, 1}) != "test.9 buffered")
+		{
+			PRINT_ERROR("ERROR :: Page write was not written out by sync().");
+		}
+
+		//a full buffer is written out without waiting for sync()
+		for (i = 0; i < File::WRITE_BATCH_PAGES; i++)
+			syncFile.allocatePage();
+		raw.seekg(0, std::ios::end);
+		if ((std::size_t)raw.tellg() < (4 + File::WRITE_BATCH_PAGES - 1) * Page::SIZE)
+		{
+			PRINT_ERROR("ERROR :: Full write buffer was not written out.");
+		}
+	}
+	File::remove(filename9);
+
+	//flushFile() is a sync point
+	{
+		File syncFile = File::create(filename9);
+		BufMgr syncMgr(10);
+		PageId syncPid;
+		syncMgr.allocPage(&syncFile, syncPid, page);
+		page->insertRecord("test.9 flushed");
+		syncMgr.unPinPage(&syncFile, syncPid, true);
+		syncMgr.flushFile(&syncFile);
+
+		std::ifstream raw(filename9.c_str(), std::ios::binary);
+		Page onDisk;
+		raw.seekg((std::streamoff)syncPid * Page::SIZE);
+		raw.read((char*)&onDisk, Page::SIZE);
+		if (!raw || onDisk.getRecord(RecordId{syncPid, 1}) != "test.9 flushed")
+		{
+			PRINT_ERROR("ERROR :: flushFile() did not write the file out.");
+		}
+	}
+	File::remove(filename9);
+
+	//so is destroying the pool, for every file it had dirty pages of
+	{
+		File syncFile = File::create(filename9);
+		PageId syncPid;
+		{
+			BufMgr syncMgr(10);
+			syncMgr.allocPage(&syncFile, syncPid, page);
+			page->insertRecord("test.9 destroyed");
+			syncMgr.unPinPage(&syncFile, syncPid, true);
+		}
+
+		std::ifstream raw(filename9.c_str(), std::ios::binary);
+		Page onDisk;
+		raw.seekg((std::streamoff)syncPid * Page::SIZE);
+		raw.read((char*)&onDisk, Page::SIZE);
+		if (!raw || onDisk.getRecord(RecordId{syncPid, 1}) != "test.9 destroyed")
+		{
+			PRINT_ERROR("ERROR :: Destroying the buffer pool did not write the file out.");
+		}
+	}
+
+	File::remove(filename9);
+	std::cout << "Test 22 passed" << "\n";
+}
+
+void test23()
+{
+	const std::string filename9 = "test.9";
+	const std::string filename10 = "test.10";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+	try
+	{
+		File::remove(filename10);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//File objects on one file share its id, and the id outlives closing it
+	FileId firstId;
+	{
+		File idFile = File::create(filename9);
+		File sameFile = File::open(filename9);
+		File otherFile = File::create(filename10);
+		firstId = idFile.id();
+		if (sameFile.id() != firstId || otherFile.id() == firstId)
+		{
+			PRINT_ERROR("ERROR :: File ids do not identify files.");
+		}
+
+		//the open state belongs to each object
+		{
+			File copied(idFile);
+			if (!copied.isOpen() || copied.id() != firstId)
+			{
+				PRINT_ERROR("ERROR :: Copied File object is not open on the file.");
+			}
+		}
+		if (!idFile.isOpen() || !File::isOpen(filename9))
+		{
+			PRINT_ERROR("ERROR :: Closing a File object closed others on the file.");
+		}
+		idFile = otherFile;
+		if (!idFile.isOpen() || idFile.id() != otherFile.id() ||
+			!sameFile.isOpen() || !File::isOpen(filename9))
+		{
+			PRINT_ERROR("ERROR :: Assigned File object did not take over the file.");
+		}
+	}
+	if (File::isOpen(filename9) || File::isOpen(filename10))
+	{
+		PRINT_ERROR("ERROR :: Files are still open.");
+	}
+	{
+		File idFile = File::open(filename9);
+		if (idFile.id() != firstId)
+		{
+			PRINT_ERROR("ERROR :: Reopened file got a new id.");
+		}
+	}
+
+	File::remove(filename9);
+	File::remove(filename10);
+	std::cout << "Test 23 passed" << "\n";
+}
+
+void test24()
+{
+	const std::string filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//CRC-32C check value, with and without the crc32 instruction
+	if (crc32c("123456789", 9) != 0xe3069283 ||
+	    crc32cPortable("123456789", 9) != 0xe3069283 ||
+	    crc32c("56789", 5, crc32c("1234", 4)) != 0xe3069283)
+	{
+		PRINT_ERROR("ERROR :: CRC-32C is wrong.");
+	}
+
+	//A page damaged on disk fails its checksum when read
+	{
+		File checkedFile = File::create(filename9);
+		Page damaged = checkedFile.allocatePage();
+		Page intact = checkedFile.allocatePage();
+		damaged.insertRecord("test.9 damaged");
+		intact.insertRecord("test.9 intact");
+		checkedFile.writePage(damaged);
+		checkedFile.writePage(intact);
+		checkedFile.sync();
+
+		{
+			std::fstream raw(filename9.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+			raw.seekp((std::streamoff)(damaged.page_number() + 1) * Page::SIZE - 1);
+			raw.put('x');
+		}
+		try
+		{
+			checkedFile.readPage(damaged.page_number());
+			PRINT_ERROR("ERROR :: Damaged page read. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const CorruptPageException &e)
+		{
+			if (e.page_number() != damaged.page_number())
+			{
+				PRINT_ERROR("ERROR :: Wrong page reported damaged.");
+			}
+		}
+
+		BufMgr checkedMgr(10);
+		try
+		{
+			checkedMgr.readPage(&checkedFile, damaged.page_number(), page);
+			PRINT_ERROR("ERROR :: Damaged page read. Exception should have been thrown before execution reaches this point.");
+		}
+		catch(const CorruptPageException &e)
+		{
+		}
+		checkedMgr.readPage(&checkedFile, intact.page_number(), page);
+		if (page->getRecord(RecordId{intact.page_number(), 1}) != "test.9 intact")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+		checkedMgr.unPinPage(&checkedFile, intact.page_number(), false);
+
+		//writing the page again stamps it afresh
+		checkedFile.writePage(damaged);
+		if (checkedFile.readPage(damaged.page_number()).getRecord(RecordId{damaged.page_number(), 1}) != "test.9 damaged")
+		{
+			PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+		}
+	}
+
+	File::remove(filename9);
+	std::cout << "Test 24 passed" << "\n";
+}
+
+//Checks that the records of the page are those numbered below <count> and not
+//a multiple of three, in slot order
+void checkEveryThirdDeleted(Page& slotted, const PageId count)
+{
+	PageId expected = 1;
+	for (PageIterator iter = slotted.begin(); iter != slotted.end(); ++iter)
+	{
+		sprintf((char*)tmpbuf, "slot %u", expected);
+		if (expected >= count || *iter != tmpbuf)
+		{
+			PRINT_ERROR("ERROR :: Iteration did not skip the free slots.");
+		}
+		expected += expected % 3 == 2 ? 2 : 1;
+	}
+	if (expected < count)
+	{
+		PRINT_ERROR("ERROR :: Iteration missed used slots.");
+	}
+}
+
+void test25()
+{
+	const std::string filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//Free slots are reused lowest first, and iteration skips them, across
+	//several groups of slots
+	Page slotted;
+	std::vector<RecordId> slotRids;
+	for (i = 0; i < 300; i++)
+	{
+		sprintf((char*)tmpbuf, "slot %u", i);
+		slotRids.push_back(slotted.insertRecord(tmpbuf));
+	}
+	for (i = 0; i < 300; i += 3)
+		slotted.deleteRecord(slotRids[i]);
+	checkEveryThirdDeleted(slotted, 300);
+	for (i = 0; i < 300; i += 3)
+	{
+		if (slotted.insertRecord("slot again").slot_number != slotRids[i].slot_number)
+		{
+			PRINT_ERROR("ERROR :: Free slots were not reused lowest first.");
+		}
+	}
+	for (i = 0; i < 300; i++)
+		slotted.deleteRecord(slotRids[i]);
+	if (slotted.getFreeSpace() != Page::DATA_SIZE || slotted.begin() != slotted.end())
+	{
+		PRINT_ERROR("ERROR :: Emptied page did not give back its slots.");
+	}
+
+	//A version 3 file, whose slot arrays have no bitmaps, is upgraded
+	PageId slotPid;
+	{
+		File slotFile = File::create(filename9);
+		Page filled = slotFile.allocatePage();
+		slotPid = filled.page_number();
+		for (i = 0; i < 100; i++)
+		{
+			sprintf((char*)tmpbuf, "slot %u", i);
+			slotRids[i] = filled.insertRecord(tmpbuf);
+		}
+		for (i = 0; i < 100; i += 3)
+			filled.deleteRecord(slotRids[i]);
+		slotFile.writePage(filled);
+	}
+	{
+		std::fstream raw(filename9.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::uint32_t version = 3;
+		raw.seekp(sizeof(std::uint32_t));
+		raw.write((const char*)&version, sizeof(version));
+		Page current;
+		raw.seekg((std::streamoff)slotPid * Page::SIZE);
+		raw.read((char*)&current, Page::SIZE);
+		raw.seekp((std::streamoff)slotPid * Page::SIZE);
+		raw.write(ungroupedPage(current).data(), Page::SIZE);
+	}
+	{
+		//read-only, converted as it is read
+		File slotFile = File::open(filename9);
+		FileIterator iter = slotFile.begin();
+		if (iter == slotFile.end() || (*iter).page_number() != slotPid || ++iter != slotFile.end())
+		{
+			PRINT_ERROR("ERROR :: Used pages of a file in the old layout were not found.");
+		}
+		Page converted = slotFile.readPage(slotPid);
+		checkEveryThirdDeleted(converted, 100);
+	}
+	File::upgrade(filename9);
+	{
+		File slotFile = File::open(filename9);
+		Page upgraded = slotFile.readPage(slotPid);
+		checkEveryThirdDeleted(upgraded, 100);
+		if (upgraded.insertRecord("slot again").slot_number != 1)
+		{
+			PRINT_ERROR("ERROR :: Free slots were lost in the upgrade.");
+		}
+	}
+
+	File::remove(filename9);
+	std::cout << "Test 25 passed" << "\n";
+}
+
+void test26()
+{
+	const std::string filename9 = "test.9";
+	try
+	{
+		File::remove(filename9);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+
+	//An update no longer than the record is done in place, and what it gives
+	//up is free space
+	Page holed;
+	std::vector<RecordId> holeRids;
+	for (i = 0; i < 100; i++)
+	{
+		sprintf((char*)tmpbuf, "record %03u", i);
+		holeRids.push_back(holed.insertRecord(tmpbuf));
+	}
+	const std::uint16_t filledFree = holed.getFreeSpace();
+	holed.updateRecord(holeRids[10], "short");
+	holed.updateRecord(holeRids[20], "same size!");
+	if (holed.getFreeSpace() != filledFree + 5 || holed.getRecord(holeRids[10]) != "short" ||
+		holed.getRecord(holeRids[20]) != "same size!")
+	{
+		PRINT_ERROR("ERROR :: Record was not updated in place.");
+	}
+
+	//Deletes leave holes, which an insert too big for the space between the
+	//slots and the records closes up
+	for (i = 30; i < 100; i += 2)
+		holed.deleteRecord(holeRids[i]);
+	const std::string big(holed.getFreeSpace(), 'b');
+	const RecordId bigRid = holed.insertRecord(big);
+	if (holed.getFreeSpace() != 0 || holed.getRecord(bigRid) != big)
+	{
+		PRINT_ERROR("ERROR :: Holes were not compacted for an insert.");
+	}
+
+	//So does an update that grows a record past that space
+	holed.deleteRecord(bigRid);
+	for (i = 1; i < 6; i++)
+		holed.deleteRecord(holeRids[i]);
+	const std::string grown(holed.getFreeSpace() + 10, 'g');
+	holed.updateRecord(holeRids[0], grown);
+	if (holed.getFreeSpace() != 0 || holed.getRecord(holeRids[0]) != grown)
+	{
+		PRINT_ERROR("ERROR :: Holes were not compacted for an update.");
+	}
+	for (i = 6; i < 100; i++)
+	{
+		if (i >= 30 && i % 2 == 0)
+			continue;
+		sprintf((char*)tmpbuf, "record %03u", i);
+		const std::string expected = i == 10 ? "short" : i == 20 ? "same size!" : tmpbuf;
+		if (holed.getRecord(holeRids[i]) != expected)
+		{
+			PRINT_ERROR("ERROR :: Compaction damaged a record.");
+		}
+	}
+
+	//New slots taken from space a record filled start out unused
+	holed.deleteRecord(holeRids[0]);
+	while (holed.hasSpaceForRecord("new slot"))
+		holed.insertRecord("new slot");
+
+	//A version 4 file, whose page headers do not count the holes, is upgraded
+	PageId holedPid;
+	std::uint16_t upgradedFree;
+	{
+		File holedFile = File::create(filename9);
+		Page filled = holedFile.allocatePage();
+		holedPid = filled.page_number();
+		for (i = 0; i < 50; i++)
+		{
+			sprintf((char*)tmpbuf, "record %03u", i);
+			holeRids[i] = filled.insertRecord(tmpbuf);
+		}
+		upgradedFree = filled.getFreeSpace();
+		holedFile.writePage(filled);
+	}
+	{
+		std::fstream raw(filename9.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+		const std::uint32_t version = 4;
+		raw.seekp(sizeof(std::uint32_t));
+		raw.write((const char*)&version, sizeof(version));
+		Page current;
+		raw.seekg((std::streamoff)holedPid * Page::SIZE);
+		raw.read((char*)&current, Page::SIZE);
+		raw.seekp((std::streamoff)holedPid * Page::SIZE);
+		raw.write(unfragmentedPage(current).data(), Page::SIZE);
+	}
+	{
+		//read-only, converted as it is read
+		File holedFile = File::open(filename9);
+		if (holedFile.readPage(holedPid).getFreeSpace() != upgradedFree)
+		{
+			PRINT_ERROR("ERROR :: Free space changed in the conversion.");
+		}
+	}
+	File::upgrade(filename9);
+	{
+		File holedFile = File::open(filename9);
+		Page upgraded = holedFile.readPage(holedPid);
+		if (upgraded.getFreeSpace() != upgradedFree)
+		{
+			PRINT_ERROR("ERROR :: Free space changed in the upgrade.");
+		}
+		upgraded.deleteRecord(holeRids[0]);
+		const std::string fill(upgraded.getFreeSpace(), 'f');
+		upgraded.insertRecord(fill);
+		for (i = 1; i < 50; i++)
+		{
+			sprintf((char*)tmpbuf, "record %03u", i);
+			if (upgraded.getRecord(holeRids[i]) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Records were damaged in the upgrade.");
+			}
+		}
+	}
+
+	File::remove(filename9);
+	std::cout << "Test 26 passed" << "\n";
+}
+
+void test27()
+{
+	//Views point at the records in a pinned frame, and match the copies
+	PageId viewPid;
+	Page* viewPage;
+	bufMgr->allocPage(file1ptr, viewPid, viewPage);
+	std::vector<RecordId> viewRids;
+	for (i = 0; i < 20; i++)
+	{
+		sprintf((char*)tmpbuf, "view %02u", i);
+		viewRids.push_back(viewPage->insertRecord(tmpbuf));
+	}
+	const char* frameStart = (const char*)viewPage;
+	for (i = 0; i < 20; i++)
+	{
+		const RecordView view = viewPage->getRecordView(viewRids[i]);
+		if (view.data() < frameStart || view.data() >= frameStart + Page::SIZE ||
+			view != viewPage->getRecord(viewRids[i]))
+		{
+			PRINT_ERROR("ERROR :: Record view does not point at the record in the frame.");
+		}
+	}
+	i = 0;
+	for (PageIterator iter = viewPage->begin(); iter != viewPage->end(); ++iter, i++)
+	{
+		if (iter.view() != *iter)
+		{
+			PRINT_ERROR("ERROR :: Iterator view does not match the record.");
+		}
+	}
+	if (i != 20)
+	{
+		PRINT_ERROR("ERROR :: Iterator views skipped records.");
+	}
+
+	//A view of a record on the same page can be inserted, and can replace
+	//another record, even where that moves the records around
+	const RecordId copyRid = viewPage->insertRecord(viewPage->getRecordView(viewRids[3]));
+	viewPage->updateRecord(viewRids[5], viewPage->getRecordView(viewRids[5]));
+	const RecordId holeRid = viewPage->insertRecord(std::string(100, 'h'));
+	const std::string big(100, 'b');
+	const RecordId bigRid = viewPage->insertRecord(big);
+	viewPage->insertRecord(std::string(viewPage->getFreeSpace() - 14, 'f'));
+	viewPage->deleteRecord(holeRid);
+	viewPage->updateRecord(viewRids[7], viewPage->getRecordView(bigRid));
+	if (viewPage->getRecordView(copyRid) != "view 03" ||
+		viewPage->getRecordView(viewRids[5]) != "view 05" ||
+		viewPage->getRecordView(viewRids[7]) != big ||
+		viewPage->getRecordView(bigRid) != big)
+	{
+		PRINT_ERROR("ERROR :: Record was not copied from a view of the same page.");
+	}
+	bufMgr->unPinPage(file1ptr, viewPid, true);
+
+	std::cout << "Test 27 passed" << "\n";
+}
+
+void test28()
+{
+	//Pages whose home is the last bucket wrap around to the front of the table,
+	//and a page whose home is the first bucket is pushed further along behind them
+	BufHashTbl table(4);	//eight buckets
+	const std::uint64_t mask = 7;
+	std::vector<PageId> wrapped;
+	PageId behind = 0;
+	for (i = 1; wrapped.size() < 3 || behind == 0; i++)
+	{
+		const std::uint64_t home = BufHashTbl::hash(file1ptr->id(), i) & mask;
+		if (home == mask && wrapped.size() < 3)
+			wrapped.push_back(i);
+		else if (home == 0 && behind == 0)
+			behind = i;
+	}
+	for (i = 0; i < 3; i++)
+		table.insert(file1ptr, wrapped[i], i);
+	table.insert(file1ptr, behind, 3);
+
+	//Erasing the head of the run shifts the rest back, across the end of the table.
+	//A second File object for the same file finds the same entries.
+	File sameFile = File::open(file1ptr->filename());
+	FrameId frameNo;
+	if (!table.erase(file1ptr, wrapped[0]) || table.find(&sameFile, wrapped[0], frameNo))
+	{
+		PRINT_ERROR("ERROR :: Erased page still found.");
+	}
+	for (i = 1; i < 3; i++)
+	{
+		if (!table.find(&sameFile, wrapped[i], frameNo) || frameNo != i)
+		{
+			PRINT_ERROR("ERROR :: Page displaced by an erase was not found.");
+		}
+	}
+	if (!table.find(&sameFile, behind, frameNo) || frameNo != 3)
+	{
+		PRINT_ERROR("ERROR :: Page displaced by an erase was not found.");
+	}
+
+	//Erasing from the middle of the run, now at the front of the table
+	table.remove(&sameFile, wrapped[1]);
+	if (!table.find(file1ptr, wrapped[2], frameNo) || frameNo != 2 ||
+		!table.find(file1ptr, behind, frameNo) || frameNo != 3 ||
+		table.find(file1ptr, wrapped[1], frameNo))
+	{
+		PRINT_ERROR("ERROR :: Page displaced by an erase was not found.");
+	}
+
+	std::cout << "Test 28 passed" << "\n";
+}
+
+void test29()
+{
+	//find() and erase() report a miss through their result, and leave the frame alone
+	BufHashTbl table(4);
+	FrameId frameNo = 5;
+	if (table.find(file1ptr, 1, frameNo) || table.erase(file1ptr, 1) || frameNo != 5)
+	{
+		PRINT_ERROR("ERROR :: Page found in an empty hash table.");
+	}
+	table.insert(file1ptr, 1, 2);
+	if (!table.find(file1ptr, 1, frameNo) || frameNo != 2)
+	{
+		PRINT_ERROR("ERROR :: Page in the hash table was not found.");
+	}
+	frameNo = 5;
+	if (table.find(file2ptr, 1, frameNo) || table.find(file1ptr, 2, frameNo) || frameNo != 5)
+	{
+		PRINT_ERROR("ERROR :: Page of another file or number was found.");
+	}
+
+	//lookup() and remove() still throw on a miss
+	try
+	{
+		table.lookup(file1ptr, 2, frameNo);
+		PRINT_ERROR("ERROR :: Missing page looked up. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const HashNotFoundException &e)
+	{
+	}
+	try
+	{
+		table.remove(file1ptr, 2);
+		PRINT_ERROR("ERROR :: Missing page removed. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const HashNotFoundException &e)
+	{
+	}
+	if (!table.erase(file1ptr, 1) || table.find(file1ptr, 1, frameNo))
+	{
+		PRINT_ERROR("ERROR :: Erased page still found.");
+	}
+
+	//Only a miss goes to disk, and unpinning a page that is not in the pool is ignored
+	BufMgr findMgr(4);
+	findMgr.unPinPage(file1ptr, 1, false);
+	findMgr.readPage(file1ptr, 1, page);
+	findMgr.readPage(file1ptr, 1, page);
+	if (findMgr.getBufStats().diskreads != 1 || findMgr.getBufStats().accesses != 2)
+	{
+		PRINT_ERROR("ERROR :: A buffer hit went to disk.");
+	}
+	findMgr.unPinPage(file1ptr, 1, false);
+	findMgr.unPinPage(file1ptr, 1, false);
+	try
+	{
+		findMgr.unPinPage(file1ptr, 1, false);
+		PRINT_ERROR("ERROR :: Page unpinned too often. Exception should have been thrown before execution reaches this point.");
+	}
+	catch(const PageNotPinnedException &e)
+	{
+	}
+
+	std::cout << "Test 29 passed" << "\n";
+}
+
+void test30()
+{
+	//A miss is read straight into its frame, and the hit after it is handed that frame
+	BufMgr missMgr(4);
+	missMgr.readPage(file1ptr, 3, page);
+	const FrameId missFrame = page - missMgr.bufPool;
+	if (page < missMgr.bufPool || missFrame >= 4 || missMgr.getBufStats().diskreads != 1)
+	{
+		PRINT_ERROR("ERROR :: Missed page was not read into a frame.");
+	}
+	Page onDisk = file1ptr->readPage(3);
+	if (memcmp(&onDisk, page, Page::SIZE) != 0)
+	{
+		PRINT_ERROR("ERROR :: Frame does not hold the page as it is on disk.");
+	}
+	Page* hit;
+	missMgr.readPage(file1ptr, 3, hit);
+	if (hit != page || missMgr.getBufStats().diskreads != 1)
+	{
+		PRINT_ERROR("ERROR :: Buffer hit was not handed the frame of the miss.");
+	}
+	missMgr.unPinPage(file1ptr, 3, false);
+	missMgr.unPinPage(file1ptr, 3, false);
+
+	//A new page is allocated in its frame too
+	PageId newPid;
+	missMgr.allocPage(file5ptr, newPid, page);
+	if (page < missMgr.bufPool || page - missMgr.bufPool >= 4 || page->page_number() != newPid)
+	{
+		PRINT_ERROR("ERROR :: Allocated page was not set up in a frame.");
+	}
+	missMgr.unPinPage(file5ptr, newPid, false);
+	missMgr.disposePage(file5ptr, newPid);
+
+	std::cout << "Test 30 passed" << "\n";
+}
+
+void test31()
+{
+	//A page is one block, its records inside it, and a copy is the same bytes
+	if (sizeof(Page) != Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: Page is not one block of Page::SIZE bytes.");
+	}
+	Page block;
+	const std::string record = "test.31 inline record";
+	block.insertRecord(record);
+	const char* first = reinterpret_cast<const char*>(&block);
+	if (std::search(first, first + Page::SIZE, record.begin(), record.end()) == first + Page::SIZE)
+	{
+		PRINT_ERROR("ERROR :: Record is not stored inside the page.");
+	}
+	Page copy = block;
+	if (memcmp(&copy, &block, Page::SIZE) != 0)
+	{
+		PRINT_ERROR("ERROR :: Page copy differs from the original.");
+	}
+
+	//Every frame of the pool is aligned for direct I/O
+	BufMgr alignMgr(5);
+	for (i = 0; i < 5; i++)
+	{
+		if (reinterpret_cast<std::uintptr_t>(alignMgr.bufPool + i) % File::DIRECT_ALIGNMENT != 0)
+		{
+			PRINT_ERROR("ERROR :: Buffer frame is not aligned for direct I/O.");
+		}
+	}
+
+	//A page read from a file holds the same bytes as the file
+	file1ptr->sync();
+	Page readBack = file1ptr->readPage(3);
+	std::ifstream raw(file1ptr->filename().c_str(), std::ios::binary);
+	raw.seekg((std::streamoff)3 * Page::SIZE);
+	raw.read(reinterpret_cast<char*>(&copy), Page::SIZE);
+	if (!raw || memcmp(&copy, &readBack, Page::SIZE) != 0)
+	{
+		PRINT_ERROR("ERROR :: Page differs from its bytes on disk.");
+	}
+
+	std::cout << "Test 31 passed" << "\n";
+}
+
+void test32()
+{
+	const std::string filename = "test.32";
+	{
+		//Two File objects for one file share its descriptor and see each other's writes
+		File writer = File::create(filename);
+		File reader = File::open(filename);
+		std::vector<PageId> pids;
+		for (i = 0; i < 8; i++)
+		{
+			Page newPage = writer.allocatePage();
+			sprintf((char*)tmpbuf, "test.32 Page %u", newPage.page_number());
+			newPage.insertRecord(tmpbuf);
+			writer.writePage(newPage);
+			pids.push_back(newPage.page_number());
+		}
+		for (i = 0; i < 8; i++)
+		{
+			Page copy = reader.readPage(pids[i]);
+			sprintf((char*)tmpbuf, "test.32 Page %u", pids[i]);
+			if (copy.getRecord(RecordId{pids[i], 1}) != tmpbuf)
+			{
+				PRINT_ERROR("ERROR :: Page written through one File object was not read through another.");
+			}
+		}
+		Page updated = reader.readPage(pids[3]);
+		updated.insertRecord("written by the reader");
+		reader.writePage(updated);
+		if (writer.readPage(pids[3]).getRecord(RecordId{pids[3], 2}) != "written by the reader")
+		{
+			PRINT_ERROR("ERROR :: Page written through one File object was not read through another.");
+		}
+
+		//Positional reads share no file position, so concurrent readers each get their own pages
+		std::atomic<int> misread(0);
+		std::vector<std::thread> readers;
+		for (int t = 0; t < 2; t++)
+		{
+			File* through = t ? &writer : &reader;
+			readers.push_back(std::thread([through, &pids, &misread, t]() {
+				for (int round = 0; round < 50; round++)
+					for (std::size_t j = 0; j < pids.size(); j++)
+					{
+						const PageId pid = t ? pids[j] : pids[pids.size() - 1 - j];
+						if (through->readPage(pid).page_number() != pid)
+							misread++;
+					}
+			}));
+		}
+		for (std::size_t t = 0; t < readers.size(); t++)
+			readers[t].join();
+		if (misread != 0)
+		{
+			PRINT_ERROR("ERROR :: Concurrent readers read each other's pages.");
+		}
+
+		//Once synced, the page is where pread finds it through a descriptor of our own
+		writer.sync();
+		const int fd = ::open(filename.c_str(), O_RDONLY);
+		Page raw;
+		if (fd < 0 || ::pread(fd, &raw, Page::SIZE, (off_t)pids[3] * Page::SIZE) != (ssize_t)Page::SIZE ||
+			memcmp(&raw, &updated, offsetof(PageHeader, checksum)) != 0 ||
+			raw.getRecord(RecordId{pids[3], 2}) != "written by the reader")
+		{
+			PRINT_ERROR("ERROR :: Page is not on disk where it belongs.");
+		}
+		::close(fd);
+	}
+	File::remove(filename);
+
+	std::cout << "Test 32 passed" << "\n";
+}
 
 // page being invalid and flush
 // tests on clock algorithm
-
@@ -5,7 +5,11 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <vector>
 
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
@@ -21,87 +25,98 @@ Page::Page() {
 }
 
 void Page::initialize() {
+  // clears the padding too, which the checksum covers
+  std::memset(&header_, 0, sizeof(header_));
   header_.free_space_lower_bound = 0;
   header_.free_space_upper_bound = DATA_SIZE;
   header_.num_slots = 0;
   header_.num_free_slots = 0;
   header_.current_page_number = INVALID_NUMBER;
   header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_.checksum = 0;
+  header_.fragmented_free_space = 0;
+  std::memset(data_, 0, DATA_SIZE);
 }
 
-RecordId Page::insertRecord(const std::string& record_data) {
+RecordId Page::insertRecord(const RecordView& record_data) {
+  if (holds(record_data)) {
+    return insertRecord(record_data.toString());
+  }
   if (!hasSpaceForRecord(record_data)) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), getFreeSpace());
   }
+  if (header_.free_space_lower_bound + insertSize(record_data) >
+      header_.free_space_upper_bound) {
+    compact();
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
 std::string Page::getRecord(const RecordId& record_id) const {
+  return getRecordView(record_id).toString();
+}
+
+RecordView Page::getRecordView(const RecordId& record_id) const {
   validateRecordId(record_id);
   const PageSlot& slot = getSlot(record_id.slot_number);
-  return data_.substr(slot.item_offset, slot.item_length);
+  return RecordView(&data_[slot.item_offset], slot.item_length);
 }
 
 void Page::updateRecord(const RecordId& record_id,
-                        const std::string& record_data) {
+                        const RecordView& record_data) {
+  if (holds(record_data)) {
+    updateRecord(record_id, record_data.toString());
+    return;
+  }
   validateRecordId(record_id);
-  const PageSlot* slot = getSlot(record_id.slot_number);
+  PageSlot* slot = getSlot(record_id.slot_number);
+  const std::uint16_t record_length = record_data.length();
+  if (record_data.length() <= slot->item_length) {
+    // Write it in place, at the end of the old version so that what is given
+    // up comes before it and may border the free space.
+    const std::uint16_t shrink = slot->item_length - record_length;
+    releaseSpace(slot->item_offset, shrink);
+    slot->item_offset += shrink;
+    slot->item_length = record_length;
+    std::memcpy(&data_[slot->item_offset], record_data.data(), record_length);
+    return;
+  }
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
   if (record_data.length() > free_space_after_delete) {
     throw InsufficientSpaceException(
         page_number(), record_data.length(), free_space_after_delete);
   }
-  // We have to disallow slot compaction here because we're going to place the
-  // record data in the same slot, and compaction might delete the slot if we
-  // permit it.
-  deleteRecord(record_id, false /* allow_slot_compaction */);
-  insertRecordInSlot(record_id.slot_number, record_data);
+  releaseSpace(slot->item_offset, slot->item_length);
+  // The slot stays used, holding nothing, while the page is compacted.
+  slot->item_offset = header_.free_space_upper_bound;
+  slot->item_length = 0;
+  if (record_length >
+      header_.free_space_upper_bound - header_.free_space_lower_bound) {
+    compact();
+  }
+  slot->item_offset = header_.free_space_upper_bound - record_length;
+  slot->item_length = record_length;
+  header_.free_space_upper_bound = slot->item_offset;
+  std::memcpy(&data_[slot->item_offset], record_data.data(), record_length);
 }
 
 void Page::deleteRecord(const RecordId& record_id) {
-  deleteRecord(record_id, true /* allow_slot_compaction */);
-}
-
-void Page::deleteRecord(const RecordId& record_id,
-                        const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot* slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset; 
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot* other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
-  }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string& data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
-  }
-  header_.free_space_upper_bound += slot->item_length;
+  // Leave a hole; compact() closes it up once an insert needs the space.
+  releaseSpace(slot->item_offset, slot->item_length);
 
   // Mark slot as unused.
-  slot->used = false;
+  setSlotUsed(record_id.slot_number, false);
   slot->item_offset = 0;
   slot->item_length = 0;
   ++header_.num_free_slots;
 
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
+  if (record_id.slot_number == header_.num_slots) {
     // Last slot in the list, so we need to free any unused slots that are at
     // the end of the slot list.
     int num_slots_to_delete = 1;
@@ -118,52 +133,170 @@ void Page::deleteRecord(const RecordId& record_id,
     }
     header_.num_slots -= num_slots_to_delete;
     header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+    header_.free_space_lower_bound = slotArraySize(header_.num_slots);
+  }
+
+  if (header_.num_free_slots == header_.num_slots) {
+    // No records left, so nothing to compact either.
+    header_.free_space_upper_bound = DATA_SIZE;
+    header_.fragmented_free_space = 0;
+  }
+}
+
+void Page::releaseSpace(const std::uint16_t offset,
+                        const std::uint16_t length) {
+  if (offset == header_.free_space_upper_bound) {
+    header_.free_space_upper_bound += length;
+  } else {
+    header_.fragmented_free_space += length;
+  }
+}
+
+void Page::compact() {
+  // The used slots, last record in the data area first.  A record ending
+  // where an empty one sits comes before it.
+  std::vector<SlotId> slots;
+  slots.reserve(header_.num_slots - header_.num_free_slots);
+  for (SlotId i = findSlot(1, true /* used */); i != INVALID_SLOT;
+       i = findSlot(i + 1, true /* used */)) {
+    slots.push_back(i);
   }
+  std::sort(slots.begin(), slots.end(), [this](SlotId a, SlotId b) {
+    const PageSlot* slot_a = getSlot(a);
+    const PageSlot* slot_b = getSlot(b);
+    const std::size_t end_a = slot_a->item_offset + slot_a->item_length;
+    const std::size_t end_b = slot_b->item_offset + slot_b->item_length;
+    return end_a != end_b ? end_a > end_b
+                          : slot_a->item_offset > slot_b->item_offset;
+  });
+
+  std::size_t top = DATA_SIZE;
+  std::size_t i = 0;
+  while (i < slots.size()) {
+    // Gather the run of records with no hole between them.
+    const PageSlot* slot = getSlot(slots[i]);
+    const std::size_t end = slot->item_offset + slot->item_length;
+    std::size_t start = slot->item_offset;
+    std::size_t next = i + 1;
+    while (next < slots.size()) {
+      slot = getSlot(slots[next]);
+      if (slot->item_offset + slot->item_length != start) {
+        break;
+      }
+      start = slot->item_offset;
+      ++next;
+    }
+    // Shift it up against the run above it.
+    const std::size_t shift = top - end;
+    if (shift > 0) {
+      std::memmove(&data_[start + shift], &data_[start], end - start);
+      for (; i < next; ++i) {
+        getSlot(slots[i])->item_offset += shift;
+      }
+    }
+    top = start + shift;
+    i = next;
+  }
+  header_.free_space_upper_bound = top;
+  header_.fragmented_free_space = 0;
+}
+
+bool Page::hasSpaceForRecord(const RecordView& record_data) const {
+  return insertSize(record_data) <= getFreeSpace();
 }
 
-bool Page::hasSpaceForRecord(const std::string& record_data) const {
+std::size_t Page::insertSize(const RecordView& record_data) const {
   std::size_t record_size = record_data.length();
   if (header_.num_free_slots == 0) {
-    record_size += sizeof(PageSlot);
+    record_size += slotArraySize(header_.num_slots + 1) -
+        slotArraySize(header_.num_slots);
   }
-  return record_size <= getFreeSpace();
+  return record_size;
+}
+
+bool Page::holds(const RecordView& record_data) const {
+  // compared as integers, since the bytes are most likely elsewhere
+  const std::uintptr_t data =
+      reinterpret_cast<std::uintptr_t>(record_data.data());
+  const std::uintptr_t page = reinterpret_cast<std::uintptr_t>(data_);
+  return data >= page && data < page + DATA_SIZE;
 }
 
 PageSlot* Page::getSlot(const SlotId slot_number) {
-  return reinterpret_cast<PageSlot*>(&data_[(slot_number - 1) * sizeof(PageSlot)]);
+  return reinterpret_cast<PageSlot*>(&data_[slotOffset(slot_number)]);
 }
 
 const PageSlot& Page::getSlot(const SlotId slot_number) const {
-  return *reinterpret_cast<const PageSlot*>(&data_[(slot_number - 1) * sizeof(PageSlot)]);
+  return *reinterpret_cast<const PageSlot*>(&data_[slotOffset(slot_number)]);
+}
+
+std::size_t Page::slotArraySize(const SlotId num_slots) {
+  const std::size_t groups =
+      (num_slots + SLOTS_PER_GROUP - 1) / SLOTS_PER_GROUP;
+  return groups * sizeof(std::uint64_t) + num_slots * sizeof(PageSlot);
+}
+
+std::size_t Page::slotOffset(const SlotId slot_number) {
+  // slots are numbered from 1, and each group starts with its bitmap word
+  const std::size_t index = slot_number - 1;
+  return slotArraySize(index - index % SLOTS_PER_GROUP) +
+      sizeof(std::uint64_t) + index % SLOTS_PER_GROUP * sizeof(PageSlot);
+}
+
+SlotId Page::findSlot(const SlotId from, const bool used) const {
+  std::size_t index = from - 1;
+  while (index < header_.num_slots) {
+    std::uint64_t word;
+    std::memcpy(&word, &data_[slotArraySize(index - index % SLOTS_PER_GROUP)],
+                sizeof(word));
+    if (!used) {
+      word = ~word;
+    }
+    word &= ~(std::uint64_t) 0 << (index % SLOTS_PER_GROUP);
+    if (word != 0) {
+      index += __builtin_ctzll(word) - index % SLOTS_PER_GROUP;
+      return index < header_.num_slots ? index + 1 : INVALID_SLOT;
+    }
+    index += SLOTS_PER_GROUP - index % SLOTS_PER_GROUP;
+  }
+  return INVALID_SLOT;
+}
+
+void Page::setSlotUsed(const SlotId slot_number, const bool used) {
+  const std::size_t index = slot_number - 1;
+  char* bits = &data_[slotArraySize(index - index % SLOTS_PER_GROUP)];
+  std::uint64_t word;
+  std::memcpy(&word, bits, sizeof(word));
+  const std::uint64_t bit = (std::uint64_t) 1 << (index % SLOTS_PER_GROUP);
+  word = used ? word | bit : word & ~bit;
+  std::memcpy(bits, &word, sizeof(word));
+  getSlot(slot_number)->used = used;
 }
 
 SlotId Page::getAvailableSlot() {
   SlotId slot_number = INVALID_SLOT;
   if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot* slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone actually
-        // puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
+    // Have an allocated but unused slot that we can reuse.  We don't decrement
+    // the number of free slots until someone actually puts data in the slot.
+    slot_number = findSlot(1, false /* used */);
   } else {
     // Have to allocate a new slot.
     slot_number = header_.num_slots + 1;
     ++header_.num_slots;
     ++header_.num_free_slots;
-    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    // The space taken may hold leftovers of moved or deleted records, and a
+    // new group's bitmap word with it.
+    const std::size_t slot_array = slotArraySize(header_.num_slots);
+    std::memset(&data_[header_.free_space_lower_bound], 0,
+                slot_array - header_.free_space_lower_bound);
+    header_.free_space_lower_bound = slot_array;
   }
   assert(slot_number != INVALID_SLOT);
   return slot_number;
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string& record_data) {
+                              const RecordView& record_data) {
   if (slot_number > header_.num_slots ||
       slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
@@ -173,16 +306,19 @@ void Page::insertRecordInSlot(const SlotId slot_number,
     throw SlotInUseException(page_number(), slot_number);
   }
   const int record_length = record_data.length();
-  slot->used = true;
+  setSlotUsed(slot_number, true);
   slot->item_length = record_length;
   slot->item_offset = header_.free_space_upper_bound - record_length;
   header_.free_space_upper_bound = slot->item_offset;
   --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  std::memcpy(&data_[slot->item_offset], record_data.data(),
+              slot->item_length);
 }
 
 void Page::validateRecordId(const RecordId& record_id) const {
-  if (record_id.page_number != page_number()) {
+  if (record_id.page_number != page_number() ||
+      record_id.slot_number == INVALID_SLOT ||
+      record_id.slot_number > header_.num_slots) {
     throw InvalidRecordException(record_id, page_number());
   }
   const PageSlot& slot = getSlot(record_id.slot_number);
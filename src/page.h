@@ -12,6 +12,7 @@
 #include <memory>
 #include <string>
 
+#include "record_view.h"
 #include "types.h"
 
 namespace badgerdb {
@@ -57,6 +58,20 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * CRC-32C of the rest of the page, stamped by File when it writes the page
+   * out.  Only meaningful on disk; a page in memory may have changed since.
+   * Zero on a page never written.
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Bytes of free space in holes between the records, left by records deleted
+   * or shrunk by an update.  Not between the bounds above until the page is
+   * compacted.
+   */
+  std::uint16_t fragmented_free_space;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -102,6 +117,18 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * Deleting or shrinking a record leaves a hole among the records rather than
+ * moving the others.  The holes are closed up only when an insert or update
+ * needs more contiguous space than there is between the slots and the records.
+ *
+ * A Page is a plain block of SIZE bytes, so copying one is a single memcpy
+ * and it can be read from and written to disk in one piece.
+ *
+ * The slot array is kept in groups of SLOTS_PER_GROUP slots, each group behind
+ * a word with a bit per slot that is set while the slot is used.  Finding a
+ * slot to reuse, or the next record to iterate to, looks at a word at a time
+ * rather than at every slot.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
@@ -133,12 +160,13 @@ class Page {
   Page();
 
   /**
-   * Inserts a new record into the page.
+   * Inserts a new record into the page.  The bytes may be a view of a record
+   * on this page.
    *
    * @param record_data  Bytes that compose the record.
    * @return  ID of the newly inserted record.
    */
-  RecordId insertRecord(const std::string& record_data);
+  RecordId insertRecord(const RecordView& record_data);
 
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
@@ -150,20 +178,34 @@ class Page {
    */
   std::string getRecord(const RecordId& record_id) const;
 
+  /**
+   * Returns a view of the record with the given ID, pointing at the bytes on
+   * the page rather than copying them.  The view is valid until the page is
+   * changed, moved or destroyed; for a page in the buffer pool, while it is
+   * pinned.
+   *
+   * @see getRecord
+   * @param record_id  ID of the record to view.
+   * @return  View of the record.
+   */
+  RecordView getRecordView(const RecordId& record_id) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
-   * new one, with the exception that the record ID will not change.
+   * new one, with the exception that the record ID will not change.  A new
+   * version no longer than the old one is written where the old one was.  The
+   * bytes may be a view of a record on this page, the old version included.
    *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
    */
-  void updateRecord(const RecordId& record_id, const std::string& record_data);
+  void updateRecord(const RecordId& record_id, const RecordView& record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Deletes the record with the given ID.  The record's space is left as a
+   * hole, unless it borders the free space.  Slot array is compacted if the
+   * slot deleted is at the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
@@ -175,15 +217,18 @@ class Page {
    * @param record_data Bytes that compose the record.
    * @return  Whether the page can hold the data.
    */
-  bool hasSpaceForRecord(const std::string& record_data) const;
+  bool hasSpaceForRecord(const RecordView& record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns this page's free space in bytes, that in holes between the records
+   * included.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const { return header_.free_space_upper_bound -
-                                              header_.free_space_lower_bound; }
+  std::uint16_t getFreeSpace() const {
+    return header_.free_space_upper_bound - header_.free_space_lower_bound +
+        header_.fragmented_free_space;
+  }
 
   /**
    * Returns this page's number in its file.
@@ -239,17 +284,38 @@ class Page {
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Returns the bytes inserting the given data takes, those of a new slot
+   * included if there is no free slot to reuse.
+   *
+   * @param record_data Bytes that compose the record.
+   * @return  Bytes the insert takes.
+   */
+  std::size_t insertSize(const RecordView& record_data) const;
+
+  /**
+   * Returns whether the given bytes lie on this page, and so may be moved by
+   * compaction or overwritten by the change they are for.
+   *
+   * @param record_data Bytes that compose a record.
+   * @return  Whether the bytes are on this page.
+   */
+  bool holds(const RecordView& record_data) const;
+
+  /**
+   * Gives back the given bytes of record data.  They join the free space if
+   * they border it, and become a hole otherwise.
    *
-   * @param record_id             ID of the record to delete.
-   * @param allow_slot_compaction If true, the slot array will be compacted if
-   *                              possible.
+   * @param offset  Offset of the bytes in the data area.
+   * @param length  Number of bytes.
    */
-  void deleteRecord(const RecordId& record_id,
-                    const bool allow_slot_compaction);
+  void releaseSpace(const std::uint16_t offset, const std::uint16_t length);
+
+  /**
+   * Moves the records up to the end of the data area, closing the holes
+   * between them, so that all the free space is between the bounds.  Records
+   * with no hole between them move together, in one memmove.
+   */
+  void compact();
 
   /**
    * Returns the slot with the given number.  This method will return
@@ -272,13 +338,55 @@ class Page {
   const PageSlot& getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
-   * header metadata, but does not mark returned slot as used.  If a new slot is
-   * allocated, updates the free space lower bound.
+   * Number of slots in each group of the slot array.
+   */
+  static const SlotId SLOTS_PER_GROUP = 64;
+
+  /**
+   * Returns the number of bytes a slot array of the given number of slots
+   * takes, the bitmap words of its groups included.
    *
-   * Callers are responsible for making sure there is enough space to allocate a
-   * new slot before calling this method.
+   * @param num_slots   Number of slots.
+   * @return  Size of the slot array.
+   */
+  static std::size_t slotArraySize(const SlotId num_slots);
+
+  /**
+   * Returns the offset of the given slot in the data area.
+   *
+   * @param slot_number   Number of slot.
+   * @return  Offset of the slot.
+   */
+  static std::size_t slotOffset(const SlotId slot_number);
+
+  /**
+   * Returns the first allocated slot numbered <from> or higher that is used
+   * (or unused, if <used> is false), going by the bitmap words.
+   *
+   * @param from    Number of slot to start at.
+   * @param used    Whether to look for a used slot or for an unused one.
+   * @return  Number of the slot found, or INVALID_SLOT if there is none.
+   */
+  SlotId findSlot(const SlotId from, const bool used) const;
+
+  /**
+   * Marks the given slot used or unused, both in the slot and in the bitmap
+   * word of its group.
+   *
+   * @param slot_number   Number of slot.
+   * @param used          Whether the slot is now used.
+   */
+  void setSlotUsed(const SlotId slot_number, const bool used);
+
+  /**
+   * Returns the slot number of an available slot, the lowest one if there are
+   * several.  If no slots are available to be reused, allocates a new slot.
+   * Updates available slot count in the header metadata, but does not mark
+   * returned slot as used.  If a new slot is allocated, updates the free space
+   * lower bound.
+   *
+   * Callers are responsible for making sure there is enough contiguous space
+   * to allocate a new slot before calling this method.
    *
    * Since the returned slot is not marked as used, callers must take care to
    * fill the slot or mark it used before someone else calls this method.
@@ -291,8 +399,8 @@ class Page {
    * Inserts record data into the given slot.  The slot should not be currently
    * in use.  <slot_number> must be less than <header_.num_slots>.
    *
-   * Callers are responsible for making sure there is enough space to hold the
-   * record before calling this method.
+   * Callers are responsible for making sure there is enough contiguous space to
+   * hold the record before calling this method.
    *
    * @param slot_number   Number of slot to insert record into.
    * @param record_data   Bytes that compose the record.
@@ -301,7 +409,7 @@ class Page {
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
   void insertRecordInSlot(const SlotId slot_number,
-                          const std::string& record_data);
+                          const RecordView& record_data);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -327,10 +435,10 @@ class Page {
 
   /**
    * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * well as actual content.  Together with the header it forms a single
+   * block of SIZE bytes laid out exactly as the page is on disk.
    */
-
-  std::string data_;
+  char data_[DATA_SIZE];
 
   friend class File;
   friend class PageIterator;
@@ -342,5 +450,7 @@ static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(sizeof(Page) == Page::SIZE,
+              "Page must be laid out exactly as it is on disk.");
 
 }
@@ -0,0 +1,143 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Read-only view of the bytes of a record, owned elsewhere.
+ *
+ * A view is a pointer and a length and copies nothing.  One returned by a Page
+ * points into the page itself: it stays valid while the page does, that is,
+ * while a page in the buffer pool stays pinned, and until the page is changed.
+ * Strings and C strings convert to views, so anything taking a view takes them
+ * too.
+ */
+class RecordView {
+ public:
+  /**
+   * Constructs a view of no bytes.
+   */
+  RecordView()
+      : data_(NULL),
+        size_(0) {
+  }
+
+  /**
+   * Constructs a view of the given bytes.
+   *
+   * @param data  First byte.
+   * @param size  Number of bytes.
+   */
+  RecordView(const char* data, const std::size_t size)
+      : data_(data),
+        size_(size) {
+  }
+
+  /**
+   * Constructs a view of the bytes of a string, valid while the string is
+   * neither changed nor destroyed.
+   *
+   * @param str   String to view.
+   */
+  RecordView(const std::string& str)
+      : data_(str.data()),
+        size_(str.size()) {
+  }
+
+  /**
+   * Constructs a view of a C string, its terminating null excluded.
+   *
+   * @param str   C string to view.
+   */
+  RecordView(const char* str)
+      : data_(str),
+        size_(std::strlen(str)) {
+  }
+
+  /**
+   * Returns the first byte of the view.
+   *
+   * @return  Pointer to the bytes.
+   */
+  const char* data() const { return data_; }
+
+  /**
+   * Returns the number of bytes in the view.
+   *
+   * @return  Size in bytes.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * Returns the number of bytes in the view.
+   *
+   * @return  Length in bytes.
+   */
+  std::size_t length() const { return size_; }
+
+  /**
+   * Returns whether the view has no bytes.
+   *
+   * @return  True if the view is empty.
+   */
+  bool empty() const { return size_ == 0; }
+
+  /**
+   * Returns the byte at the given position.
+   *
+   * @param pos   Position of the byte, less than size().
+   * @return  The byte.
+   */
+  char operator[](const std::size_t pos) const { return data_[pos]; }
+
+  /**
+   * Returns a copy of the bytes as a string.
+   *
+   * @return  The bytes.
+   */
+  std::string toString() const { return std::string(data_, size_); }
+
+  /**
+   * Returns true if this view has the same bytes as the other.
+   *
+   * @param rhs   View to compare against.
+   * @return  Whether the bytes are equal.
+   */
+  bool operator==(const RecordView& rhs) const {
+    return size_ == rhs.size_ &&
+        (size_ == 0 || std::memcmp(data_, rhs.data_, size_) == 0);
+  }
+
+  /**
+   * Returns true if this view has bytes different from the other's.
+   *
+   * @param rhs   View to compare against.
+   * @return  Whether the bytes differ.
+   */
+  bool operator!=(const RecordView& rhs) const {
+    return !(*this == rhs);
+  }
+
+ private:
+  /**
+   * First byte viewed.
+   */
+  const char* data_;
+
+  /**
+   * Number of bytes viewed.
+   */
+  std::size_t size_;
+};
+
+}
@@ -0,0 +1,372 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include "replacer.h"
+
+namespace badgerdb {
+
+//----------------------------------------
+// GhostList
+//----------------------------------------
+
+void GhostList::push(const PageKey& key)
+{
+    erase(key);
+    order.push_front(key);
+    index[key] = order.begin();
+}
+
+bool GhostList::erase(const PageKey& key)
+{
+    std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash>::iterator found =
+        index.find(key);
+    if (found == index.end())
+        return false;
+    order.erase(found->second);
+    index.erase(found);
+    return true;
+}
+
+PageKey GhostList::popOldest()
+{
+    assert(!order.empty());
+    const PageKey key = order.back();
+    index.erase(key);
+    order.pop_back();
+    return key;
+}
+
+//----------------------------------------
+// Replacer
+//----------------------------------------
+
+Replacer* Replacer::create(const ReplacementPolicy policy, const std::uint32_t numFrames)
+{
+    switch (policy) {
+    case ReplacementPolicy::ARC:
+        return new ArcReplacer(numFrames);
+    case ReplacementPolicy::TWO_Q:
+        return new TwoQReplacer(numFrames);
+    case ReplacementPolicy::LRU_2:
+        return new Lru2Replacer(numFrames);
+    case ReplacementPolicy::CLOCK:
+    default:
+        return NULL;
+    }
+}
+
+Replacer::Replacer(const std::uint32_t numFrames)
+    : numFrames(numFrames), keys(numFrames), states(numFrames, FREE),
+      freePositions(numFrames)
+{
+    for (FrameId i = 0; i < numFrames; i++)
+        freePositions[i] = freeFrames.insert(freeFrames.end(), i);
+}
+
+bool Replacer::pickVictim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (!freeFrames.empty()) {
+        frameNo = freeFrames.front();
+        return true;
+    }
+    return victim(frameNo, isPinned);
+}
+
+void Replacer::recordSkip(const FrameId frameNo)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (states[frameNo] == FREE) {
+        // rotate, so the next pick nominates another free frame
+        freeFrames.erase(freePositions[frameNo]);
+        freePositions[frameNo] = freeFrames.insert(freeFrames.end(), frameNo);
+    } else if (states[frameNo] == RESIDENT) {
+        skipped(frameNo);
+    }
+}
+
+void Replacer::recordEvict(const FrameId frameNo)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (states[frameNo] == FREE)
+        freeFrames.erase(freePositions[frameNo]);
+    else if (states[frameNo] == RESIDENT)
+        removed(frameNo, true /* evicted */);
+    states[frameNo] = TAKEN;
+}
+
+void Replacer::recordLoad(const FrameId frameNo, const File* file, const PageId pageNo)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (states[frameNo] == FREE)
+        freeFrames.erase(freePositions[frameNo]);
+    else if (states[frameNo] == RESIDENT)
+        removed(frameNo, false /* evicted */);
+    keys[frameNo].fileId = file->id();
+    keys[frameNo].pageNo = pageNo;
+    states[frameNo] = RESIDENT;
+    loaded(frameNo);
+}
+
+void Replacer::recordAccess(const FrameId frameNo)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (states[frameNo] == RESIDENT)
+        accessed(frameNo);
+}
+
+void Replacer::recordFree(const FrameId frameNo)
+{
+    std::lock_guard<std::mutex> guard(latch);
+    if (states[frameNo] == FREE)
+        return;
+    if (states[frameNo] == RESIDENT)
+        removed(frameNo, false /* evicted */);
+    states[frameNo] = FREE;
+    freePositions[frameNo] = freeFrames.insert(freeFrames.end(), frameNo);
+}
+
+//----------------------------------------
+// ARC
+//----------------------------------------
+
+ArcReplacer::ArcReplacer(const std::uint32_t numFrames)
+    : Replacer(numFrames), p(0), lists(numFrames, NULL), positions(numFrames)
+{
+}
+
+void ArcReplacer::loaded(const FrameId frameNo)
+{
+    const PageKey& key = keys[frameNo];
+    if (b1.contains(key)) {
+        // T1 was too small to keep this page; grow it
+        const std::uint32_t delta = std::max<std::uint32_t>(1, b1.size() ? b2.size() / b1.size() : 1);
+        p = std::min(numFrames, p + delta);
+        b1.erase(key);
+        lists[frameNo] = &t2;
+    } else if (b2.contains(key)) {
+        const std::uint32_t delta = std::max<std::uint32_t>(1, b2.size() ? b1.size() / b2.size() : 1);
+        p = p > delta ? p - delta : 0;
+        b2.erase(key);
+        lists[frameNo] = &t2;
+    } else {
+        lists[frameNo] = &t1;
+    }
+    lists[frameNo]->push_front(frameNo);
+    positions[frameNo] = lists[frameNo]->begin();
+    trimGhosts();
+}
+
+void ArcReplacer::accessed(const FrameId frameNo)
+{
+    lists[frameNo]->erase(positions[frameNo]);
+    lists[frameNo] = &t2;
+    t2.push_front(frameNo);
+    positions[frameNo] = t2.begin();
+}
+
+void ArcReplacer::removed(const FrameId frameNo, const bool evicted)
+{
+    std::list<FrameId>* list = lists[frameNo];
+    list->erase(positions[frameNo]);
+    lists[frameNo] = NULL;
+    if (evicted) {
+        (list == &t1 ? b1 : b2).push(keys[frameNo]);
+        trimGhosts();
+    }
+}
+
+void ArcReplacer::skipped(const FrameId frameNo)
+{
+    lists[frameNo]->erase(positions[frameNo]);
+    lists[frameNo]->push_front(frameNo);
+    positions[frameNo] = lists[frameNo]->begin();
+}
+
+bool ArcReplacer::victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned)
+{
+    // take from T1 while it is over its target size, otherwise from T2; fall back to
+    // the other list if everything in the preferred one is pinned
+    std::list<FrameId>* order[2] = {&t1, &t2};
+    if (t1.size() <= p)
+        std::swap(order[0], order[1]);
+    for (int i = 0; i < 2; i++) {
+        for (std::list<FrameId>::reverse_iterator it = order[i]->rbegin(); it != order[i]->rend(); ++it) {
+            if (!isPinned(*it)) {
+                frameNo = *it;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ArcReplacer::trimGhosts()
+{
+    while (t1.size() + b1.size() > numFrames && b1.size() > 0)
+        b1.popOldest();
+    while (t1.size() + t2.size() + b1.size() + b2.size() > 2 * numFrames) {
+        if (b2.size() > 0)
+            b2.popOldest();
+        else
+            b1.popOldest();
+    }
+}
+
+//----------------------------------------
+// 2Q
+//----------------------------------------
+
+TwoQReplacer::TwoQReplacer(const std::uint32_t numFrames)
+    : Replacer(numFrames), kIn(std::max<std::uint32_t>(1, numFrames / 4)),
+      kOut(std::max<std::uint32_t>(1, numFrames / 2)), lists(numFrames, NULL),
+      positions(numFrames)
+{
+}
+
+void TwoQReplacer::loaded(const FrameId frameNo)
+{
+    // pages referenced again soon after leaving A1in have proven themselves hot
+    lists[frameNo] = a1out.erase(keys[frameNo]) ? &am : &a1in;
+    lists[frameNo]->push_front(frameNo);
+    positions[frameNo] = lists[frameNo]->begin();
+}
+
+void TwoQReplacer::accessed(const FrameId frameNo)
+{
+    // A1in is a FIFO; hits there are correlated references and do not count
+    if (lists[frameNo] == &am) {
+        am.erase(positions[frameNo]);
+        am.push_front(frameNo);
+        positions[frameNo] = am.begin();
+    }
+}
+
+void TwoQReplacer::removed(const FrameId frameNo, const bool evicted)
+{
+    std::list<FrameId>* list = lists[frameNo];
+    list->erase(positions[frameNo]);
+    lists[frameNo] = NULL;
+    if (evicted && list == &a1in) {
+        a1out.push(keys[frameNo]);
+        if (a1out.size() > kOut)
+            a1out.popOldest();
+    }
+}
+
+void TwoQReplacer::skipped(const FrameId frameNo)
+{
+    lists[frameNo]->erase(positions[frameNo]);
+    lists[frameNo]->push_front(frameNo);
+    positions[frameNo] = lists[frameNo]->begin();
+}
+
+bool TwoQReplacer::victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned)
+{
+    std::list<FrameId>* order[2] = {&a1in, &am};
+    if (a1in.size() <= kIn)
+        std::swap(order[0], order[1]);
+    for (int i = 0; i < 2; i++) {
+        for (std::list<FrameId>::reverse_iterator it = order[i]->rbegin(); it != order[i]->rend(); ++it) {
+            if (!isPinned(*it)) {
+                frameNo = *it;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+//----------------------------------------
+// LRU-2
+//----------------------------------------
+
+Lru2Replacer::Lru2Replacer(const std::uint32_t numFrames)
+    : Replacer(numFrames), now(0), last(numFrames, 0), prev(numFrames, 0)
+{
+}
+
+void Lru2Replacer::unlink(const FrameId frameNo)
+{
+    if (prev[frameNo] == 0)
+        once.erase(std::make_pair(last[frameNo], frameNo));
+    else
+        twice.erase(std::make_pair(prev[frameNo], frameNo));
+}
+
+void Lru2Replacer::link(const FrameId frameNo)
+{
+    if (prev[frameNo] == 0)
+        once.insert(std::make_pair(last[frameNo], frameNo));
+    else
+        twice.insert(std::make_pair(prev[frameNo], frameNo));
+}
+
+void Lru2Replacer::loaded(const FrameId frameNo)
+{
+    const PageKey& key = keys[frameNo];
+    std::unordered_map<PageKey, std::uint64_t, PageKeyHash>::iterator found = history.find(key);
+    if (found != history.end()) {
+        prev[frameNo] = found->second;
+        history.erase(found);
+        historyOrder.erase(key);
+    } else {
+        prev[frameNo] = 0;
+    }
+    last[frameNo] = ++now;
+    link(frameNo);
+}
+
+void Lru2Replacer::accessed(const FrameId frameNo)
+{
+    unlink(frameNo);
+    prev[frameNo] = last[frameNo];
+    last[frameNo] = ++now;
+    link(frameNo);
+}
+
+void Lru2Replacer::removed(const FrameId frameNo, const bool evicted)
+{
+    unlink(frameNo);
+    if (evicted) {
+        history[keys[frameNo]] = last[frameNo];
+        historyOrder.push(keys[frameNo]);
+        if (historyOrder.size() > numFrames)
+            history.erase(historyOrder.popOldest());
+    }
+}
+
+void Lru2Replacer::skipped(const FrameId frameNo)
+{
+    // move it to the back of its queue without inventing a second access
+    unlink(frameNo);
+    if (prev[frameNo] == 0) {
+        last[frameNo] = ++now;
+    } else {
+        prev[frameNo] = ++now;
+        last[frameNo] = now;
+    }
+    link(frameNo);
+}
+
+bool Lru2Replacer::victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned)
+{
+    const AccessOrder* order[2] = {&once, &twice};
+    for (int i = 0; i < 2; i++) {
+        for (AccessOrder::const_iterator it = order[i]->begin(); it != order[i]->end(); ++it) {
+            if (!isPinned(it->second)) {
+                frameNo = it->second;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}
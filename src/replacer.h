@@ -0,0 +1,435 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "file.h"
+#include "bufHashTbl.h"
+
+namespace badgerdb {
+
+/**
+* @brief Page replacement policies a BufMgr can be constructed with
+*/
+enum class ReplacementPolicy
+{
+	/**
+   * Single reference bit clock sweep
+	 */
+  CLOCK,
+
+	/**
+   * Adaptive Replacement Cache (Megiddo and Modha)
+	 */
+  ARC,
+
+	/**
+   * Full 2Q (Johnson and Shasha) with a FIFO probation queue
+	 */
+  TWO_Q,
+
+	/**
+   * LRU-K (O'Neil, O'Neil and Weikum) with K = 2
+	 */
+  LRU_2
+};
+
+
+/**
+* @brief Identifies a page of a file, whether or not it is in the buffer pool
+*/
+struct PageKey
+{
+	/**
+   * Id of the file the page belongs to
+	 */
+  FileId fileId;
+
+	/**
+   * Page number within the file
+	 */
+  PageId pageNo;
+
+  bool operator==(const PageKey& rhs) const
+  {
+    return fileId == rhs.fileId && pageNo == rhs.pageNo;
+  }
+};
+
+
+/**
+* @brief Hash function object for PageKey
+*/
+struct PageKeyHash
+{
+  std::size_t operator()(const PageKey& key) const
+  {
+    return (std::size_t) BufHashTbl::hash(key.fileId, key.pageNo);
+  }
+};
+
+
+/**
+* @brief Bounded FIFO of page keys that are no longer resident (a ghost list)
+*/
+class GhostList
+{
+ public:
+	/**
+   * Returns true if the key is in the list
+	 */
+  bool contains(const PageKey& key) const
+  {
+    return index.count(key) != 0;
+  }
+
+	/**
+   * Number of keys in the list
+	 */
+  std::size_t size() const
+  {
+    return order.size();
+  }
+
+	/**
+   * Adds a key as the newest entry
+	 */
+  void push(const PageKey& key);
+
+	/**
+   * Removes a key
+	 *
+	 * @return  			True if the key was present
+	 */
+  bool erase(const PageKey& key);
+
+	/**
+   * Removes the oldest key.  The list must not be empty.
+	 *
+	 * @return  			The key removed
+	 */
+  PageKey popOldest();
+
+ private:
+	/**
+   * Keys, newest first
+	 */
+  std::list<PageKey> order;
+
+	/**
+   * Position of each key in order
+	 */
+  std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> index;
+};
+
+
+/**
+* @brief Chooses which buffer frame to reuse next
+*
+* BufMgr reports every frame's life cycle to the replacer: a frame is loaded with a
+* page, accessed while resident, and eventually evicted (which may leave a ghost entry
+* behind for adaptation) or freed outright.  Free frames are always handed out before
+* resident ones.
+*
+* pickVictim() only nominates a frame; the buffer manager still has to latch the frame
+* and confirm it is unpinned before calling recordEvict().  If it cannot, it calls
+* recordSkip() so that the next pick moves on.
+*
+* All public methods are serialized by a latch inside the replacer.
+*/
+class Replacer
+{
+ public:
+	/**
+   * Creates a replacer for the given policy
+	 *
+	 * @param policy   	Replacement policy
+	 * @param numFrames	Number of frames in the buffer pool
+	 * @return  			New replacer, or NULL for ReplacementPolicy::CLOCK, which BufMgr
+	 *               	implements itself
+	 */
+  static Replacer* create(const ReplacementPolicy policy, const std::uint32_t numFrames);
+
+  virtual ~Replacer() {}
+
+	/**
+   * Nominates the next frame to reuse
+	 *
+	 * @param frameNo  	Nominated frame returned via this reference
+	 * @param isPinned 	Returns true for frames that cannot currently be evicted
+	 * @return  			False if every frame is resident and pinned
+	 */
+  bool pickVictim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned);
+
+	/**
+   * Records that a nominated frame could not be claimed
+	 */
+  void recordSkip(const FrameId frameNo);
+
+	/**
+   * Records that a frame has been claimed for reuse.  Its old page, if any, is
+   * remembered as recently evicted.
+	 */
+  void recordEvict(const FrameId frameNo);
+
+	/**
+   * Records that a claimed frame now holds the given page
+	 */
+  void recordLoad(const FrameId frameNo, const File* file, const PageId pageNo);
+
+	/**
+   * Records a buffer hit on a resident frame
+	 */
+  void recordAccess(const FrameId frameNo);
+
+	/**
+   * Records that a frame no longer holds a page and may be reused at once
+	 */
+  void recordFree(const FrameId frameNo);
+
+ protected:
+	/**
+   * Constructor of Replacer class
+	 *
+	 * @param numFrames	Number of frames in the buffer pool
+	 */
+  explicit Replacer(const std::uint32_t numFrames);
+
+	/**
+   * Policy hook: a claimed frame was loaded with keys[frameNo]
+	 */
+  virtual void loaded(const FrameId frameNo) = 0;
+
+	/**
+   * Policy hook: a resident frame was accessed
+	 */
+  virtual void accessed(const FrameId frameNo) = 0;
+
+	/**
+   * Policy hook: a resident frame is leaving the pool
+	 *
+	 * @param frameNo  	Frame leaving
+	 * @param evicted  	True if it was chosen as a victim (remember it as a ghost); false
+	 *               	if its page was flushed or disposed
+	 */
+  virtual void removed(const FrameId frameNo, const bool evicted) = 0;
+
+	/**
+   * Policy hook: a nominated resident frame could not be claimed
+	 */
+  virtual void skipped(const FrameId frameNo) = 0;
+
+	/**
+   * Policy hook: nominate an unpinned resident frame
+	 */
+  virtual bool victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned) = 0;
+
+	/**
+   * Number of frames in the buffer pool
+	 */
+  std::uint32_t numFrames;
+
+	/**
+   * Page held by each frame; only meaningful for resident frames
+	 */
+  std::vector<PageKey> keys;
+
+ private:
+	/**
+   * Life cycle state of a frame
+	 */
+  enum FrameState { FREE, TAKEN, RESIDENT };
+
+	/**
+   * Serializes the public methods
+	 */
+  std::mutex latch;
+
+	/**
+   * State of each frame
+	 */
+  std::vector<FrameState> states;
+
+	/**
+   * Free frames, handed out from the front
+	 */
+  std::list<FrameId> freeFrames;
+
+	/**
+   * Position of each free frame in freeFrames
+	 */
+  std::vector<std::list<FrameId>::iterator> freePositions;
+};
+
+
+/**
+* @brief Adaptive Replacement Cache
+*
+* Resident pages seen once live in T1 and pages seen at least twice in T2; the ghost
+* lists B1 and B2 remember pages recently evicted from each, and a hit in a ghost list
+* moves the target size of T1 towards the list that would have kept the page.
+*/
+class ArcReplacer : public Replacer
+{
+ public:
+  explicit ArcReplacer(const std::uint32_t numFrames);
+
+ protected:
+  virtual void loaded(const FrameId frameNo);
+  virtual void accessed(const FrameId frameNo);
+  virtual void removed(const FrameId frameNo, const bool evicted);
+  virtual void skipped(const FrameId frameNo);
+  virtual bool victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned);
+
+ private:
+	/**
+   * Drops the oldest ghosts until the lists are back within their bounds
+	 */
+  void trimGhosts();
+
+	/**
+   * Target size of T1
+	 */
+  std::uint32_t p;
+
+	/**
+   * Resident frames seen once and seen at least twice, most recent first
+	 */
+  std::list<FrameId> t1, t2;
+
+	/**
+   * List holding each resident frame, and its position there
+	 */
+  std::vector<std::list<FrameId>*> lists;
+  std::vector<std::list<FrameId>::iterator> positions;
+
+	/**
+   * Ghosts of pages evicted from T1 and from T2
+	 */
+  GhostList b1, b2;
+};
+
+
+/**
+* @brief 2Q replacement
+*
+* New pages enter the FIFO A1in and are evicted from it without promotion unless they
+* are referenced again after leaving, while their keys are still in the ghost queue
+* A1out; such pages go to the LRU queue Am.  A single scan therefore only ever cycles
+* through A1in.
+*/
+class TwoQReplacer : public Replacer
+{
+ public:
+  explicit TwoQReplacer(const std::uint32_t numFrames);
+
+ protected:
+  virtual void loaded(const FrameId frameNo);
+  virtual void accessed(const FrameId frameNo);
+  virtual void removed(const FrameId frameNo, const bool evicted);
+  virtual void skipped(const FrameId frameNo);
+  virtual bool victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned);
+
+ private:
+	/**
+   * Target size of A1in
+	 */
+  std::uint32_t kIn;
+
+	/**
+   * Maximum size of A1out
+	 */
+  std::uint32_t kOut;
+
+	/**
+   * Resident frames on probation and proven hot, most recent first
+	 */
+  std::list<FrameId> a1in, am;
+
+	/**
+   * List holding each resident frame, and its position there
+	 */
+  std::vector<std::list<FrameId>*> lists;
+  std::vector<std::list<FrameId>::iterator> positions;
+
+	/**
+   * Ghosts of pages evicted from A1in
+	 */
+  GhostList a1out;
+};
+
+
+/**
+* @brief LRU-2 replacement
+*
+* Evicts the page whose second most recent access is oldest.  Pages accessed only once
+* have an infinite backward 2-distance and go first, oldest first.  Access history of
+* evicted pages is retained for as many pages as there are frames.
+*/
+class Lru2Replacer : public Replacer
+{
+ public:
+  explicit Lru2Replacer(const std::uint32_t numFrames);
+
+ protected:
+  virtual void loaded(const FrameId frameNo);
+  virtual void accessed(const FrameId frameNo);
+  virtual void removed(const FrameId frameNo, const bool evicted);
+  virtual void skipped(const FrameId frameNo);
+  virtual bool victim(FrameId& frameNo, const std::function<bool(FrameId)>& isPinned);
+
+ private:
+  typedef std::set<std::pair<std::uint64_t, FrameId> > AccessOrder;
+
+	/**
+   * Takes a resident frame out of the access order it is in
+	 */
+  void unlink(const FrameId frameNo);
+
+	/**
+   * Puts a resident frame into the access order its history calls for
+	 */
+  void link(const FrameId frameNo);
+
+	/**
+   * Logical clock, advanced on every access
+	 */
+  std::uint64_t now;
+
+	/**
+   * Most recent and second most recent access of each resident frame; a second most
+   * recent access of 0 means the page was accessed only once
+	 */
+  std::vector<std::uint64_t> last, prev;
+
+	/**
+   * Frames accessed once, ordered by last access
+	 */
+  AccessOrder once;
+
+	/**
+   * Frames accessed at least twice, ordered by second most recent access
+	 */
+  AccessOrder twice;
+
+	/**
+   * Last access time of recently evicted pages, and the order they were evicted in
+	 */
+  std::unordered_map<PageKey, std::uint64_t, PageKeyHash> history;
+  GhostList historyOrder;
+};
+
+}